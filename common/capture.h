@@ -0,0 +1,57 @@
+// common/capture.h
+// Chunk-stream capture file, written by lvrecv --record / lvcap record and
+// replayed by lvcap replay. Every datagram that reached the receiver is kept
+// with its arrival time and source, so field traffic can be re-sent later at
+// its original pacing.
+//
+// File layout (little-endian), append-only:
+//   capture_hdr_t                          (CAPTURE_HDR_BYTES)
+//   record, record, ...  each 8-byte aligned:
+//     capture_rec_t                        (CAPTURE_REC_BYTES)
+//     len bytes of datagram, zero-padded to a multiple of 8
+//
+// t_ns is nanoseconds since start_mono_ns (CLOCK_MONOTONIC of the recorder).
+// Nothing is ever rewritten, so a recorder that dies leaves at most a torn
+// last record; readers stop at the first record that runs past the end of
+// the file. The file can be mmap()ed and walked in place.
+
+#pragma once
+
+#include <stdint.h>
+
+#define CAPTURE_MAGIC "LVCAP1"
+#define CAPTURE_VERSION 1
+#define CAPTURE_HDR_BYTES 64
+#define CAPTURE_REC_BYTES 16
+
+typedef struct
+{
+    char magic[8]; // CAPTURE_MAGIC, NUL-padded
+    uint32_t version;
+    uint32_t hdr_bytes;     // CAPTURE_HDR_BYTES; records start here
+    uint64_t start_wall_ns; // CLOCK_REALTIME when recording started
+    uint64_t start_mono_ns; // CLOCK_MONOTONIC at the same moment
+    uint16_t port;          // UDP port the datagrams arrived on
+    uint8_t reserved[CAPTURE_HDR_BYTES - 34];
+} capture_hdr_t;
+
+typedef struct
+{
+    uint64_t t_ns;     // since start_mono_ns
+    uint32_t src_addr; // IPv4, network byte order
+    uint16_t src_port; // host byte order
+    uint16_t len;      // datagram bytes that follow
+} capture_rec_t;
+
+static inline uint32_t capture_rec_span(uint16_t len)
+{
+    return CAPTURE_REC_BYTES + ((len + 7u) & ~7u);
+}
+
+#ifdef __cplusplus
+static_assert(sizeof(capture_hdr_t) == CAPTURE_HDR_BYTES, "capture header size");
+static_assert(sizeof(capture_rec_t) == CAPTURE_REC_BYTES, "capture record size");
+#else
+_Static_assert(sizeof(capture_hdr_t) == CAPTURE_HDR_BYTES, "capture header size");
+_Static_assert(sizeof(capture_rec_t) == CAPTURE_REC_BYTES, "capture record size");
+#endif
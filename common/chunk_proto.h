@@ -0,0 +1,255 @@
+// common/chunk_proto.h
+// Chunk protocol shared by the ESP32-C3 forwarder, the host tools and the PC
+// receiver. k210/main.py packs the same layout with ustruct.
+//
+// Header = 10 bytes: <I H B B H  (little-endian)
+//   frame_id(u32), chunk_id(u16), flags(u8), rsv(u8), payload_len(u16)
+// Then payload_len bytes follow.
+//
+// NACK (receiver -> forwarder, sent back to the chunks' source address):
+//   'N' 'K' version(u8) nbytes(u8) frame_id(u32) base(u16) bitmap[nbytes]
+// Bit i of the bitmap (LSB first) asks for chunk base + i of frame_id again.
+// The forwarder resends it from its cache with CHUNK_FLAG_RETX set.
+//
+// Aggregated datagram (forwarder -> receiver, CHUNK_FLAG_AGG): several
+// consecutive chunks of one frame behind a single header. The outer header has
+// the frame_id, the first chunk's chunk_id, flags = CHUNK_FLAG_AGG,
+// rsv = number of chunks and payload_len = bytes after it. Each chunk then is
+//   chunk_id(u16) flags(u8) rsv(u8) len(u16) | len bytes of payload
+//
+// Timestamp extension (CHUNK_FLAG_EXT): the payload starts with
+//   ext_len(u8) version(u8) stream_id(u16) capture_age_us(u32) fwd_us(u32)
+// and the frame data follows at payload + ext_len (payload_len counts both).
+// stream_id names the camera (0 = unset): a receiver taking several cameras
+// on one port keys its streams by it, else by the chunks' source address.
+// The three clocks are not synchronised, so each stage is a duration measured
+// on the one device that sees both of its ends:
+//   capture_age_us  K210: camera snapshot -> this chunk goes out on SPI
+//   fwd_us          ESP32: SPI transaction done -> sendto() (0 = not stamped,
+//                   e.g. an older forwarder)
+// Receivers skip ext_len bytes, so later versions may append fields. Senders
+// with and without the extension can share one receiver; FEC (fec.h) covers
+// the frame data only.
+//
+// Integrity trailer (CHUNK_FLAG_CRC): the last CHUNK_CRC_LEN bytes of the
+// payload (counted in payload_len) are a CRC-32 (crc32.h, u32 LE) the sender
+// computed over the header and the rest of the payload. The forwarder drops
+// chunks that fail it before they cost airtime, the receiver checks it again.
+// The two things the forwarder writes into a chunk, CHUNK_FLAG_RETX and
+// fwd_us, count as 0, so the CRC holds end to end without being redone on the
+// way. Parity chunks carry no trailer and FEC covers the data before it; in
+// an aggregate each chunk keeps its own flag and trailer.
+//
+// SPI sync word (K210 -> ESP32 only, never on UDP): a sender may start every
+// header transaction with the CHUNK_SYNC_LEN bytes of CHUNK_SYNC_WORD, i.e.
+// [sync | hdr | payload] in one transaction or [sync | hdr] then [payload].
+// After a lost or cut transaction the forwarder drops bytes up to the next
+// sync word instead of reading data as a header. 0xFF followed by 'L' never
+// occurs in JPEG entropy-coded data, but JPEG tables (DQT, DHT), the timestamp
+// extension and the CRC trailer can hold the word, so a false match is
+// possible; the header behind it must then also have a payload_len that ends
+// exactly with the transaction (fwd_core.c fwd_rx_take()), and with CRC on
+// the chunk must pass its trailer.
+// While the sender clocks the sync word out on MOSI, such a forwarder clocks
+// its link status back on MISO:
+//   'S' version(u8) resyncs(u16)
+// resyncs counts (mod 2^16) the times the forwarder found the transactions out
+// of step with the framing and threw a chunk away to get back in step; a
+// sender seeing it change knows one of its chunks never made it.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define CHUNK_HDR_LEN 10
+#define CHUNK_PAYLOAD_MAX 2048
+
+#define CHUNK_FLAG_START 0x01
+#define CHUNK_FLAG_END 0x02
+#define CHUNK_FLAG_AGG 0x04  // several chunks in one datagram
+#define CHUNK_FLAG_RETX 0x08 // retransmitted in answer to a NACK
+#define CHUNK_FLAG_CRC 0x40  // payload ends with a CRC-32 trailer
+#define CHUNK_FLAG_EXT 0x80  // payload starts with the timestamp extension
+
+#define CHUNK_EXT_LEN 12
+#define CHUNK_EXT_VERSION 1
+
+#define CHUNK_CRC_LEN 4
+
+#define CHUNK_AGG_SUBHDR_LEN 6
+
+#define CHUNK_SYNC_LEN 4
+#define CHUNK_SYNC_WORD 0x53564CFFu // bytes FF 'L' 'V' 'S', read with chunk_rd32()
+#define CHUNK_LINK_STATUS_MAGIC 'S'
+#define CHUNK_LINK_STATUS_VERSION 1
+
+#define CHUNK_NACK_HDR_LEN 10
+#define CHUNK_NACK_BITMAP_MAX 32
+#define CHUNK_NACK_VERSION 1
+
+typedef struct
+{
+    uint32_t frame_id;
+    uint16_t chunk_id;
+    uint8_t flags;
+    uint8_t rsv;
+    uint16_t payload_len;
+} chunk_hdr_t;
+
+static inline uint16_t chunk_rd16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | ((uint16_t)p[1] << 8));
+}
+
+static inline uint32_t chunk_rd32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void chunk_wr16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void chunk_wr32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+// payload_len is last 2 bytes
+static inline uint16_t chunk_hdr_payload_len(const uint8_t *p)
+{
+    return chunk_rd16(p + 8);
+}
+
+static inline void chunk_hdr_parse(const uint8_t *p, chunk_hdr_t *h)
+{
+    h->frame_id = chunk_rd32(p);
+    h->chunk_id = chunk_rd16(p + 4);
+    h->flags = p[6];
+    h->rsv = p[7];
+    h->payload_len = chunk_rd16(p + 8);
+}
+
+static inline void chunk_hdr_pack(uint8_t *p, const chunk_hdr_t *h)
+{
+    chunk_wr32(p, h->frame_id);
+    chunk_wr16(p + 4, h->chunk_id);
+    p[6] = h->flags;
+    p[7] = h->rsv;
+    chunk_wr16(p + 8, h->payload_len);
+}
+
+// Sub-header of one chunk inside an aggregated datagram
+static inline void chunk_agg_sub_pack(uint8_t *p, const chunk_hdr_t *h)
+{
+    chunk_wr16(p, h->chunk_id);
+    p[2] = h->flags;
+    p[3] = h->rsv;
+    chunk_wr16(p + 4, h->payload_len);
+}
+
+static inline void chunk_agg_sub_parse(const uint8_t *p, uint32_t frame_id, chunk_hdr_t *h)
+{
+    h->frame_id = frame_id;
+    h->chunk_id = chunk_rd16(p);
+    h->flags = p[2];
+    h->rsv = p[3];
+    h->payload_len = chunk_rd16(p + 4);
+}
+
+typedef struct
+{
+    uint8_t len; // bytes of payload before the frame data
+    uint8_t version;
+    uint16_t stream_id; // 0 = unset
+    uint32_t capture_age_us;
+    uint32_t fwd_us;
+} chunk_ext_t;
+
+static inline void chunk_ext_pack(uint8_t *p, uint16_t stream_id, uint32_t capture_age_us)
+{
+    p[0] = CHUNK_EXT_LEN;
+    p[1] = CHUNK_EXT_VERSION;
+    chunk_wr16(p + 2, stream_id);
+    chunk_wr32(p + 4, capture_age_us);
+    chunk_wr32(p + 8, 0);
+}
+
+// Returns 0, or -1 if the extension does not fit in the payload
+static inline int chunk_ext_parse(const uint8_t *p, uint16_t payload_len, chunk_ext_t *e)
+{
+    if (payload_len < 2 || p[0] < 2 || p[0] > payload_len)
+        return -1;
+    e->len = p[0];
+    e->version = p[1];
+    e->stream_id = e->len >= 4 ? chunk_rd16(p + 2) : 0;
+    e->capture_age_us = e->len >= 8 ? chunk_rd32(p + 4) : 0;
+    e->fwd_us = e->len >= 12 ? chunk_rd32(p + 8) : 0;
+    return 0;
+}
+
+// Bytes of payload before the frame data: ext_len with a well-formed
+// extension, else 0
+static inline uint16_t chunk_ext_skip(uint8_t flags, const uint8_t *payload, uint16_t payload_len)
+{
+    chunk_ext_t e;
+    if (!(flags & CHUNK_FLAG_EXT) || chunk_ext_parse(payload, payload_len, &e) != 0)
+        return 0;
+    return e.len;
+}
+
+// Forwarder side: stamp fwd_us into a chunk's payload if it has room for it
+static inline void chunk_ext_set_fwd(uint8_t *payload, uint16_t payload_len, uint32_t fwd_us)
+{
+    if (payload_len >= 12 && payload[0] >= 12)
+        chunk_wr32(payload + 8, fwd_us);
+}
+
+// Bytes at the end of the payload after the frame data (the CRC trailer)
+static inline uint16_t chunk_trailer_len(uint8_t flags)
+{
+    return (flags & CHUNK_FLAG_CRC) ? CHUNK_CRC_LEN : 0;
+}
+
+typedef struct
+{
+    uint32_t frame_id;
+    uint16_t base;
+    uint8_t nbytes;
+    const uint8_t *bitmap;
+} chunk_nack_t;
+
+// Returns the NACK length: CHUNK_NACK_HDR_LEN + nbytes
+static inline size_t chunk_nack_pack(uint8_t *p, uint32_t frame_id, uint16_t base,
+                                     const uint8_t *bitmap, uint8_t nbytes)
+{
+    p[0] = 'N';
+    p[1] = 'K';
+    p[2] = CHUNK_NACK_VERSION;
+    p[3] = nbytes;
+    chunk_wr32(p + 4, frame_id);
+    chunk_wr16(p + 8, base);
+    for (uint8_t i = 0; i < nbytes; i++)
+        p[CHUNK_NACK_HDR_LEN + i] = bitmap[i];
+    return CHUNK_NACK_HDR_LEN + nbytes;
+}
+
+// Returns 0, or -1 if buf is not a well-formed NACK
+static inline int chunk_nack_parse(const uint8_t *p, size_t len, chunk_nack_t *n)
+{
+    if (len < CHUNK_NACK_HDR_LEN || p[0] != 'N' || p[1] != 'K' || p[2] != CHUNK_NACK_VERSION ||
+        p[3] > CHUNK_NACK_BITMAP_MAX || len < (size_t)CHUNK_NACK_HDR_LEN + p[3])
+        return -1;
+    n->nbytes = p[3];
+    n->frame_id = chunk_rd32(p + 4);
+    n->base = chunk_rd16(p + 8);
+    n->bitmap = p + CHUNK_NACK_HDR_LEN;
+    return 0;
+}
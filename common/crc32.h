@@ -0,0 +1,56 @@
+// common/crc32.h
+// CRC-32 (IEEE 802.3: reflected, polynomial 0xEDB88320, as zlib, Python's
+// binascii.crc32 and the ESP32 ROM compute it) and the chunk protocol's
+// integrity trailer (chunk_proto.h CHUNK_FLAG_CRC).
+//
+// The crc argument chains like zlib: crc32_ieee(0, buf, len) is the CRC of buf,
+// and passing that result back in continues it over the next buffer.
+//
+// crc32_ieee() is the fastest kernel for the platform: the ROM routine on the
+// ESP32 (CRC32_USE_ROM), slice-by-8 elsewhere. The other two are always there
+// for benchmarks and cross-checks (pc/receiver/crc_bench.cpp, and the boot log
+// of esp32c3/main/app_main.c).
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "chunk_proto.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(ESP_PLATFORM) && !defined(CRC32_USE_ROM)
+#define CRC32_USE_ROM 1
+#endif
+
+#define CRC32_CHECK_VALUE 0xCBF43926u // of "123456789"
+
+uint32_t crc32_ieee(uint32_t crc, const void *buf, size_t len);
+
+// Eight table lookups per 8 bytes, independent of each other (8 KiB of tables)
+uint32_t crc32_ieee_slice8(uint32_t crc, const void *buf, size_t len);
+
+// One table lookup per byte, each waiting for the previous (1 KiB)
+uint32_t crc32_ieee_bytewise(uint32_t crc, const void *buf, size_t len);
+
+// CRC a chunk's sender put in its trailer: over the header with
+// CHUNK_FLAG_RETX clear and the payload up to the trailer, with the timestamp
+// extension's fwd_us counted as 0. h->payload_len includes the trailer (>=
+// CHUNK_CRC_LEN). For a chunk out of an aggregate, h is its sub-header with
+// the outer frame_id (chunk_agg_sub_parse()).
+uint32_t chunk_crc(const chunk_hdr_t *h, const uint8_t *payload);
+
+// Sender side: fill the trailer of [hdr | payload], whose header already has
+// CHUNK_FLAG_CRC set and payload_len counting the trailer
+void chunk_crc_seal(uint8_t *dgram);
+
+// Receiver side: false if the trailer is missing or does not match
+bool chunk_crc_ok(const chunk_hdr_t *h, const uint8_t *payload);
+
+#ifdef __cplusplus
+}
+#endif
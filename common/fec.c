@@ -0,0 +1,301 @@
+// common/fec.c
+// Reed-Solomon parity for the chunk protocol (see fec.h). Plain C, built into
+// the ESP32-C3 firmware and the host tools alike.
+//
+// Multiplying a buffer by a constant c uses two 16-entry tables, c * low
+// nibble and c * high nibble. That is the shape of a byte shuffle, so with
+// SSSE3/AVX2/NEON one instruction does 16 or 32 table lookups; the scalar loop
+// uses the same tables and needs no per-call 256-byte row.
+
+#include <string.h>
+
+#include "fec.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// GF(2^8), x^8 + x^4 + x^3 + x^2 + 1; gf_exp is doubled to skip a mod 255
+static const uint8_t gf_exp[512] = {
+    1, 2, 4, 8, 16, 32, 64, 128, 29, 58, 116, 232, 205, 135, 19, 38,
+    76, 152, 45, 90, 180, 117, 234, 201, 143, 3, 6, 12, 24, 48, 96, 192,
+    157, 39, 78, 156, 37, 74, 148, 53, 106, 212, 181, 119, 238, 193, 159, 35,
+    70, 140, 5, 10, 20, 40, 80, 160, 93, 186, 105, 210, 185, 111, 222, 161,
+    95, 190, 97, 194, 153, 47, 94, 188, 101, 202, 137, 15, 30, 60, 120, 240,
+    253, 231, 211, 187, 107, 214, 177, 127, 254, 225, 223, 163, 91, 182, 113, 226,
+    217, 175, 67, 134, 17, 34, 68, 136, 13, 26, 52, 104, 208, 189, 103, 206,
+    129, 31, 62, 124, 248, 237, 199, 147, 59, 118, 236, 197, 151, 51, 102, 204,
+    133, 23, 46, 92, 184, 109, 218, 169, 79, 158, 33, 66, 132, 21, 42, 84,
+    168, 77, 154, 41, 82, 164, 85, 170, 73, 146, 57, 114, 228, 213, 183, 115,
+    230, 209, 191, 99, 198, 145, 63, 126, 252, 229, 215, 179, 123, 246, 241, 255,
+    227, 219, 171, 75, 150, 49, 98, 196, 149, 55, 110, 220, 165, 87, 174, 65,
+    130, 25, 50, 100, 200, 141, 7, 14, 28, 56, 112, 224, 221, 167, 83, 166,
+    81, 162, 89, 178, 121, 242, 249, 239, 195, 155, 43, 86, 172, 69, 138, 9,
+    18, 36, 72, 144, 61, 122, 244, 245, 247, 243, 251, 235, 203, 139, 11, 22,
+    44, 88, 176, 125, 250, 233, 207, 131, 27, 54, 108, 216, 173, 71, 142, 1,
+    2, 4, 8, 16, 32, 64, 128, 29, 58, 116, 232, 205, 135, 19, 38, 76,
+    152, 45, 90, 180, 117, 234, 201, 143, 3, 6, 12, 24, 48, 96, 192, 157,
+    39, 78, 156, 37, 74, 148, 53, 106, 212, 181, 119, 238, 193, 159, 35, 70,
+    140, 5, 10, 20, 40, 80, 160, 93, 186, 105, 210, 185, 111, 222, 161, 95,
+    190, 97, 194, 153, 47, 94, 188, 101, 202, 137, 15, 30, 60, 120, 240, 253,
+    231, 211, 187, 107, 214, 177, 127, 254, 225, 223, 163, 91, 182, 113, 226, 217,
+    175, 67, 134, 17, 34, 68, 136, 13, 26, 52, 104, 208, 189, 103, 206, 129,
+    31, 62, 124, 248, 237, 199, 147, 59, 118, 236, 197, 151, 51, 102, 204, 133,
+    23, 46, 92, 184, 109, 218, 169, 79, 158, 33, 66, 132, 21, 42, 84, 168,
+    77, 154, 41, 82, 164, 85, 170, 73, 146, 57, 114, 228, 213, 183, 115, 230,
+    209, 191, 99, 198, 145, 63, 126, 252, 229, 215, 179, 123, 246, 241, 255, 227,
+    219, 171, 75, 150, 49, 98, 196, 149, 55, 110, 220, 165, 87, 174, 65, 130,
+    25, 50, 100, 200, 141, 7, 14, 28, 56, 112, 224, 221, 167, 83, 166, 81,
+    162, 89, 178, 121, 242, 249, 239, 195, 155, 43, 86, 172, 69, 138, 9, 18,
+    36, 72, 144, 61, 122, 244, 245, 247, 243, 251, 235, 203, 139, 11, 22, 44,
+    88, 176, 125, 250, 233, 207, 131, 27, 54, 108, 216, 173, 71, 142, 1, 2,
+};
+
+static const uint8_t gf_log[256] = {
+    0, 0, 1, 25, 2, 50, 26, 198, 3, 223, 51, 238, 27, 104, 199, 75,
+    4, 100, 224, 14, 52, 141, 239, 129, 28, 193, 105, 248, 200, 8, 76, 113,
+    5, 138, 101, 47, 225, 36, 15, 33, 53, 147, 142, 218, 240, 18, 130, 69,
+    29, 181, 194, 125, 106, 39, 249, 185, 201, 154, 9, 120, 77, 228, 114, 166,
+    6, 191, 139, 98, 102, 221, 48, 253, 226, 152, 37, 179, 16, 145, 34, 136,
+    54, 208, 148, 206, 143, 150, 219, 189, 241, 210, 19, 92, 131, 56, 70, 64,
+    30, 66, 182, 163, 195, 72, 126, 110, 107, 58, 40, 84, 250, 133, 186, 61,
+    202, 94, 155, 159, 10, 21, 121, 43, 78, 212, 229, 172, 115, 243, 167, 87,
+    7, 112, 192, 247, 140, 128, 99, 13, 103, 74, 222, 237, 49, 197, 254, 24,
+    227, 165, 153, 119, 38, 184, 180, 124, 17, 68, 146, 217, 35, 32, 137, 46,
+    55, 63, 209, 91, 149, 188, 207, 205, 144, 135, 151, 178, 220, 252, 190, 97,
+    242, 86, 211, 171, 20, 42, 93, 158, 132, 60, 57, 83, 71, 109, 65, 162,
+    31, 45, 67, 216, 183, 123, 164, 118, 196, 23, 73, 236, 127, 12, 111, 246,
+    108, 161, 59, 82, 41, 157, 85, 170, 251, 96, 134, 177, 187, 204, 62, 90,
+    203, 89, 95, 176, 156, 169, 160, 81, 11, 245, 22, 235, 122, 117, 44, 215,
+    79, 174, 213, 233, 230, 231, 173, 232, 116, 214, 244, 234, 168, 80, 88, 175,
+};
+
+static inline uint8_t gf_mul(uint8_t a, uint8_t b)
+{
+    return (a && b) ? gf_exp[gf_log[a] + gf_log[b]] : 0;
+}
+
+static inline uint8_t gf_inv(uint8_t a)
+{
+    return gf_exp[255 - gf_log[a]];
+}
+
+uint8_t fec_coef(unsigned j, unsigned i)
+{
+    return gf_mul((uint8_t)(255 ^ i), gf_inv((uint8_t)(255 ^ j ^ i)));
+}
+
+static void xor_bytes(uint8_t *dst, const uint8_t *src, size_t n)
+{
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4)
+    {
+        uint32_t a, b;
+        memcpy(&a, dst + k, 4);
+        memcpy(&b, src + k, 4);
+        a ^= b;
+        memcpy(dst + k, &a, 4);
+    }
+    for (; k < n; k++)
+        dst[k] ^= src[k];
+}
+
+void fec_mul_add(uint8_t *dst, const uint8_t *src, size_t n, uint8_t c)
+{
+    if (c == 0)
+        return;
+    if (c == 1)
+    {
+        xor_bytes(dst, src, n);
+        return;
+    }
+
+    uint8_t lo[16], hi[16];
+    for (unsigned x = 0; x < 16; x++)
+    {
+        lo[x] = gf_mul(c, (uint8_t)x);
+        hi[x] = gf_mul(c, (uint8_t)(x << 4));
+    }
+
+    size_t k = 0;
+#if defined(__AVX2__)
+    __m256i tlo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)lo));
+    __m256i thi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)hi));
+    __m256i mask = _mm256_set1_epi8(0x0f);
+    for (; k + 32 <= n; k += 32)
+    {
+        __m256i s = _mm256_loadu_si256((const __m256i *)(src + k));
+        __m256i d = _mm256_loadu_si256((const __m256i *)(dst + k));
+        __m256i l = _mm256_shuffle_epi8(tlo, _mm256_and_si256(s, mask));
+        __m256i h = _mm256_shuffle_epi8(thi, _mm256_and_si256(_mm256_srli_epi16(s, 4), mask));
+        d = _mm256_xor_si256(d, _mm256_xor_si256(l, h));
+        _mm256_storeu_si256((__m256i *)(dst + k), d);
+    }
+#elif defined(__SSSE3__)
+    __m128i tlo = _mm_loadu_si128((const __m128i *)lo);
+    __m128i thi = _mm_loadu_si128((const __m128i *)hi);
+    __m128i mask = _mm_set1_epi8(0x0f);
+    for (; k + 16 <= n; k += 16)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + k));
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + k));
+        __m128i l = _mm_shuffle_epi8(tlo, _mm_and_si128(s, mask));
+        __m128i h = _mm_shuffle_epi8(thi, _mm_and_si128(_mm_srli_epi16(s, 4), mask));
+        d = _mm_xor_si128(d, _mm_xor_si128(l, h));
+        _mm_storeu_si128((__m128i *)(dst + k), d);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    uint8x16_t tlo = vld1q_u8(lo);
+    uint8x16_t thi = vld1q_u8(hi);
+    uint8x16_t mask = vdupq_n_u8(0x0f);
+    for (; k + 16 <= n; k += 16)
+    {
+        uint8x16_t s = vld1q_u8(src + k);
+        uint8x16_t d = vld1q_u8(dst + k);
+        uint8x16_t l = vqtbl1q_u8(tlo, vandq_u8(s, mask));
+        uint8x16_t h = vqtbl1q_u8(thi, vshrq_n_u8(s, 4));
+        vst1q_u8(dst + k, veorq_u8(d, veorq_u8(l, h)));
+    }
+#endif
+    for (; k < n; k++)
+        dst[k] ^= lo[src[k] & 15] ^ hi[src[k] >> 4];
+}
+
+const char *fec_impl(void)
+{
+#if defined(__AVX2__)
+    return "avx2";
+#elif defined(__SSSE3__)
+    return "ssse3";
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+void fec_block_add(uint8_t *parity, unsigned j, unsigned i, const uint8_t *payload, uint16_t len)
+{
+    uint8_t c = fec_coef(j, i);
+    uint8_t prefix[FEC_LEN_PREFIX];
+    chunk_wr16(prefix, len);
+
+    fec_mul_add(parity, prefix, FEC_LEN_PREFIX, c);
+    fec_mul_add(parity + FEC_LEN_PREFIX, payload, len, c);
+}
+
+int fec_solve(unsigned ne, const uint8_t *rows, const uint16_t *cols,
+              uint8_t *const *syn, size_t blen, uint8_t *const *out)
+{
+    uint8_t a[FEC_MAX_PARITY][FEC_MAX_PARITY];
+    uint8_t inv[FEC_MAX_PARITY][FEC_MAX_PARITY];
+
+    if (ne == 0 || ne > FEC_MAX_PARITY)
+        return -1;
+
+    for (unsigned r = 0; r < ne; r++)
+    {
+        for (unsigned k = 0; k < ne; k++)
+        {
+            if (rows[r] + cols[k] >= 255)
+                return -1;
+            a[r][k] = fec_coef(rows[r], cols[k]);
+            inv[r][k] = r == k;
+        }
+    }
+
+    // Gauss-Jordan on [a | inv]
+    for (unsigned col = 0; col < ne; col++)
+    {
+        unsigned piv = col;
+        while (piv < ne && a[piv][col] == 0)
+            piv++;
+        if (piv == ne)
+            return -1;
+        if (piv != col)
+        {
+            for (unsigned k = 0; k < ne; k++)
+            {
+                uint8_t t = a[col][k];
+                a[col][k] = a[piv][k];
+                a[piv][k] = t;
+                t = inv[col][k];
+                inv[col][k] = inv[piv][k];
+                inv[piv][k] = t;
+            }
+        }
+
+        uint8_t s = gf_inv(a[col][col]);
+        for (unsigned k = 0; k < ne; k++)
+        {
+            a[col][k] = gf_mul(a[col][k], s);
+            inv[col][k] = gf_mul(inv[col][k], s);
+        }
+        for (unsigned r = 0; r < ne; r++)
+        {
+            uint8_t f = a[r][col];
+            if (r == col || f == 0)
+                continue;
+            for (unsigned k = 0; k < ne; k++)
+            {
+                a[r][k] ^= gf_mul(f, a[col][k]);
+                inv[r][k] ^= gf_mul(f, inv[col][k]);
+            }
+        }
+    }
+
+    for (unsigned k = 0; k < ne; k++)
+    {
+        memset(out[k], 0, blen);
+        for (unsigned r = 0; r < ne; r++)
+            fec_mul_add(out[k], syn[r], blen, inv[k][r]);
+    }
+    return 0;
+}
+
+void fec_enc_init(fec_enc_t *e, unsigned m, uint8_t *const *bufs)
+{
+    memset(e, 0, sizeof(*e));
+    e->m = (uint8_t)(m > FEC_MAX_PARITY ? FEC_MAX_PARITY : m);
+    for (unsigned j = 0; j < e->m; j++)
+    {
+        e->parity[j] = bufs[j];
+        memset(bufs[j], 0, FEC_BLOCK_MAX);
+    }
+}
+
+void fec_enc_begin(fec_enc_t *e, uint32_t frame_id)
+{
+    // Parity past e->len is still zero from the last clear
+    for (unsigned j = 0; j < e->m; j++)
+        memset(e->parity[j], 0, e->len);
+    e->active = e->m > 0;
+    e->frame_id = frame_id;
+    e->n = 0;
+    e->len = 0;
+}
+
+bool fec_enc_add(fec_enc_t *e, uint32_t frame_id, uint16_t chunk_id,
+                 const uint8_t *payload, uint16_t len)
+{
+    if (!e->active)
+        return false;
+    if (frame_id != e->frame_id || chunk_id != e->n || e->n + e->m >= FEC_MAX_CHUNKS ||
+        len > CHUNK_PAYLOAD_MAX)
+    {
+        e->active = false;
+        return false;
+    }
+
+    for (unsigned j = 0; j < e->m; j++)
+        fec_block_add(e->parity[j], j, chunk_id, payload, len);
+
+    e->n++;
+    if (FEC_LEN_PREFIX + len > e->len)
+        e->len = (uint16_t)(FEC_LEN_PREFIX + len);
+    return true;
+}
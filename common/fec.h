@@ -0,0 +1,98 @@
+// common/fec.h
+// Per-frame forward error correction for the chunk protocol: up to
+// FEC_MAX_PARITY parity chunks let the receiver rebuild that many lost data
+// chunks of a frame without a retransmission.
+//
+// Code: systematic Reed-Solomon over GF(2^8) (polynomial 0x11d) with a Cauchy
+// parity matrix, a[j][i] = (x0 + y_i) / (x_j + y_i) with x_j = 255 ^ j and
+// y_i = i. The column scaling makes parity 0 a plain XOR of the data, so one
+// parity chunk costs no more than XOR parity; any e <= m losses are decodable
+// from any e parity chunks. Coefficients do not depend on the number of data
+// chunks, so a sender can fold chunks in as they pass and emit parity at END.
+//
+// Block i is [u16 payload_len (LE) | payload], zero-padded to the longest block
+// of the frame; parity blocks have that length. Recovered blocks therefore
+// carry their own chunk length. With the timestamp extension (chunk_proto.h
+// CHUNK_FLAG_EXT) "payload" is the frame data after it: the forwarder stamps
+// the extension, and a rebuilt chunk has no use for its timestamps. Likewise
+// a CRC trailer (CHUNK_FLAG_CRC) is left out; the block is what it protected.
+//
+// On the wire (chunk_proto.h) a parity chunk has the frame's frame_id,
+// chunk_id = n_data + j, flags 0 and rsv = CHUNK_RSV_PARITY | (m-1) << 4 | j.
+// Data chunks are unchanged, so receivers without FEC only see extra chunks.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "chunk_proto.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FEC_MAX_PARITY 8
+#define FEC_MAX_CHUNKS 256 // data + parity per frame
+#define FEC_LEN_PREFIX 2
+#define FEC_BLOCK_MAX (FEC_LEN_PREFIX + CHUNK_PAYLOAD_MAX)
+
+#define CHUNK_RSV_PARITY 0x80
+
+static inline uint8_t chunk_rsv_parity(unsigned j, unsigned m)
+{
+    return (uint8_t)(CHUNK_RSV_PARITY | ((m - 1) & 7) << 4 | (j & 15));
+}
+
+static inline unsigned chunk_parity_index(uint8_t rsv)
+{
+    return rsv & 15;
+}
+
+static inline unsigned chunk_parity_count(uint8_t rsv)
+{
+    return ((rsv >> 4) & 7) + 1;
+}
+
+// Coefficient of data chunk i in parity j
+uint8_t fec_coef(unsigned j, unsigned i);
+
+// dst[k] ^= c * src[k] for k < n (nibble tables; SSSE3/AVX2/NEON when built for them)
+void fec_mul_add(uint8_t *dst, const uint8_t *src, size_t n, uint8_t c);
+
+// Fold data chunk i (its block: length prefix + payload) into parity j
+void fec_block_add(uint8_t *parity, unsigned j, unsigned i, const uint8_t *payload, uint16_t len);
+
+// Solve for ne missing data blocks. syn[r] is parity block rows[r] with every
+// received data block folded out again (fec_block_add); cols[k] are the
+// missing chunk_ids. Writes block k to out[k] (blen bytes each, not aliasing
+// syn). Returns 0, or -1 if the system is singular (bad indices).
+int fec_solve(unsigned ne, const uint8_t *rows, const uint16_t *cols,
+              uint8_t *const *syn, size_t blen, uint8_t *const *out);
+
+// Name of the fec_mul_add() implementation compiled in
+const char *fec_impl(void);
+
+// Incremental encoder: chunks must be added in chunk_id order from 0, anything
+// else (a chunk lost upstream, a new frame before END) abandons the frame.
+typedef struct
+{
+    uint8_t m;       // parity chunks per frame, 0 = off
+    bool active;     // a frame is being folded in
+    uint32_t frame_id;
+    uint16_t n;      // data chunks so far
+    uint16_t len;    // parity block length so far
+    uint8_t *parity[FEC_MAX_PARITY]; // FEC_BLOCK_MAX bytes each, caller-owned
+} fec_enc_t;
+
+// bufs: m buffers of FEC_BLOCK_MAX bytes
+void fec_enc_init(fec_enc_t *e, unsigned m, uint8_t *const *bufs);
+void fec_enc_begin(fec_enc_t *e, uint32_t frame_id);
+// Returns false once the frame has been abandoned
+bool fec_enc_add(fec_enc_t *e, uint32_t frame_id, uint16_t chunk_id,
+                 const uint8_t *payload, uint16_t len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,53 @@
+// common/frame_ring.h
+// Shared-memory ring of recent JPEG frames, written by lvrecv (--ring PATH)
+// and read by local consumers straight out of the mapping: no syscall per
+// frame on either side. pc/ring_reader.py is a reference reader.
+//
+// File layout (little-endian, all offsets fixed):
+//   frame_ring_hdr_t                       (FRAME_RING_HDR_BYTES)
+//   slot[0] .. slot[slots-1], each slot_bytes long:
+//     frame_ring_slot_t                    (FRAME_RING_SLOT_HDR_BYTES)
+//     jpeg bytes                           (slot_bytes - FRAME_RING_SLOT_HDR_BYTES max)
+//
+// Frame n (n = 0, 1, ...) goes to slot n % slots. Each slot is a seqlock:
+// seq is 2n+1 while frame n is being written and 2n+2 once it is complete.
+// hdr.write_count is n+1 after frame n is complete, so the newest frame is
+// k = write_count-1. Reader: s1 = slot.seq (acquire); copy the JPEG;
+// s2 = slot.seq; the copy is good if s1 == s2 == 2k+2.
+
+#pragma once
+
+#include <stdint.h>
+
+#define FRAME_RING_MAGIC "LVRING1"
+#define FRAME_RING_VERSION 1
+#define FRAME_RING_HDR_BYTES 64
+#define FRAME_RING_SLOT_HDR_BYTES 32
+
+typedef struct
+{
+    char magic[8]; // FRAME_RING_MAGIC, NUL-padded
+    uint32_t version;
+    uint32_t slots;
+    uint32_t slot_bytes;
+    uint32_t reserved0;
+    uint64_t write_count; // frames completed so far
+    uint8_t reserved[FRAME_RING_HDR_BYTES - 32];
+} frame_ring_hdr_t;
+
+typedef struct
+{
+    uint64_t seq; // seqlock, see above
+    uint32_t frame_id;
+    uint32_t size;      // JPEG bytes
+    uint64_t stamp_ns;  // CLOCK_MONOTONIC when published
+    uint8_t reserved[FRAME_RING_SLOT_HDR_BYTES - 24];
+} frame_ring_slot_t;
+
+#ifdef __cplusplus
+static_assert(sizeof(frame_ring_hdr_t) == FRAME_RING_HDR_BYTES, "ring header size");
+static_assert(sizeof(frame_ring_slot_t) == FRAME_RING_SLOT_HDR_BYTES, "ring slot header size");
+#else
+_Static_assert(sizeof(frame_ring_hdr_t) == FRAME_RING_HDR_BYTES, "ring header size");
+_Static_assert(sizeof(frame_ring_slot_t) == FRAME_RING_SLOT_HDR_BYTES, "ring slot header size");
+#endif
@@ -0,0 +1,71 @@
+// common/telemetry.h
+// Forwarder telemetry datagram, sent once a second to UDP_HOST_PORT + 1 (the
+// chunk stream's port + 1). pc/telemetry.py parses and plots it.
+//
+// Layout (little-endian):
+//   'L' 'V' 'T' 'M' version(u8) count(u8) rsv(u16) | count x u32
+// The u32 fields are in telem_field_t order. Counters are cumulative and wrap
+// (take differences modulo 2^32); *_cycles run at cpu_mhz; gauges are marked.
+// New fields only ever go at the end, so older parsers keep working.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "chunk_proto.h"
+
+#define TELEM_VERSION 1
+#define TELEM_HDR_LEN 8
+
+typedef enum
+{
+    TELEM_SEQ,
+    TELEM_UPTIME_MS,
+    TELEM_CPU_MHZ, // gauge
+    TELEM_RX_CHUNKS,
+    TELEM_RX_BYTES,
+    TELEM_RX_DROPPED,
+    TELEM_SPI_WAIT_CYCLES,
+    TELEM_TX_CHUNKS,
+    TELEM_TX_DGRAMS,
+    TELEM_TX_BYTES,
+    TELEM_TX_ERRORS,
+    TELEM_TX_ENOMEM,
+    TELEM_SEND_CYCLES,
+    TELEM_FWD_CYCLES,
+    TELEM_BACKLOG_SUM, // tx queue depth summed over rx chunks
+    TELEM_FEC_CHUNKS,
+    TELEM_RETX_CHUNKS,
+    TELEM_NACKS,
+    TELEM_AGG_DGRAMS,
+    TELEM_FREE_HEAP, // gauge
+    TELEM_TX_RETRIES,
+    TELEM_TX_LOST,
+    TELEM_TX_SHED,
+    TELEM_FRAMES_SHED,
+    TELEM_TX_STALE,
+    TELEM_FRAMES_STALE,
+    TELEM_RX_CRC_BAD,
+    TELEM_CRC_CYCLES,
+    TELEM_RX_RESYNCS,
+    TELEM_RX_SKIPPED,
+    TELEM_COUNT
+} telem_field_t;
+
+#define TELEM_LEN (TELEM_HDR_LEN + 4 * TELEM_COUNT)
+
+// buf: TELEM_LEN bytes; returns TELEM_LEN
+static inline size_t telem_pack(uint8_t *p, const uint32_t *fields)
+{
+    p[0] = 'L';
+    p[1] = 'V';
+    p[2] = 'T';
+    p[3] = 'M';
+    p[4] = TELEM_VERSION;
+    p[5] = TELEM_COUNT;
+    chunk_wr16(p + 6, 0);
+    for (unsigned i = 0; i < TELEM_COUNT; i++)
+        chunk_wr32(p + TELEM_HDR_LEN + 4 * i, fields[i]);
+    return TELEM_LEN;
+}
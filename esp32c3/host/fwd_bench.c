@@ -0,0 +1,516 @@
+// host/fwd_bench.c
+// Drive fwd_core on Linux with a simulated SPI source and a real UDP socket,
+// and report chunks/s and bytes/s. Single-threaded by default: every chunk
+// goes through fwd_rx_next() + fwd_tx(), so the figure is core cost +
+// sendto() cost. --threads splits rx and tx over two threads and a queue the
+// way app_main does, and reports how long chunks wait in that queue.
+//
+//   fwd_bench [--chunks N] [--frame-bytes N] [--chunk-bytes N] [--split]
+//             [--host IP] [--port N] [--min-chunks-per-sec N] [--fec M]
+//             [--fps N] [--loss P] [--retx N] [--retx-deadline-ms N]
+//             [--agg BYTES] [--agg-deadline-us N] [--telemetry]
+//             [--congest P] [--congest-us N] [--retry-us N] [--backoff-us N]
+//             [--threads] [--link-kbps N] [--latest] [--stamp] [--stream-id N]
+//             [--crc] [--flip P] [--sync] [--cut P]
+//
+// --stamp sends chunks with the timestamp extension (chunk_proto.h
+// CHUNK_FLAG_EXT), which the core stamps like the ESP32 does; lvrecv then logs
+// per-stage latency. --stream-id N (implies --stamp) puts a camera id in it;
+// several instances with different ids make a multi-camera load for lvrecv.
+//
+// --crc sends chunks with a CRC trailer (chunk_proto.h CHUNK_FLAG_CRC) and
+// checks it in the core like CRC_CHECK on the ESP32; the check's cost is
+// reported per chunk. --flip P flips one bit in that share of SPI
+// transactions: the core should drop every garbled chunk it can see (a flip in
+// the flag byte can clear CHUNK_FLAG_CRC itself), and lvrecv count none as bad:
+//   fwd_bench --crc --flip 0.01 --fps 30
+//
+// --sync starts header transactions with the SPI sync word (chunk_proto.h
+// CHUNK_SYNC_WORD) like k210/main.py; --cut P ends that share of transactions
+// at a random byte, or loses them altogether (the K210 giving up on a chunk
+// after its header). With --sync, every cut or flip must cost at most the one
+// chunk it hit, or the run fails (exit 1); without it, compare how many
+// chunks the same faults cost:
+//   fwd_bench --split --sync --cut 0.01 --flip 0.01 --crc
+//
+// Degraded link: --link-kbps makes each send take its airtime, so with
+// --threads the queue fills up; --latest (LATEST_FRAME_WINS on the ESP32)
+// skips queued frames that a newer one has overtaken. Compare the queue wait:
+//   fwd_bench --threads --fps 30 --frame-bytes 3000 --link-kbps 600 --latest
+// Congestion: --congest starts, with that chance per datagram, a spell of
+// --congest-us during which sendto() fails with ENOMEM. --retry-us retries a
+// failed send for up to N us (RETRY_DEADLINE_US on the ESP32), backing off
+// from --backoff-us. Frames that still lose chunks are shed; compare the
+// frames lvrecv completes with and without retries.
+//
+// --telemetry sends the ESP32's once-a-second telemetry datagram
+// (common/telemetry.h) to port + 1, for trying pc/telemetry.py without a board.
+//
+// --agg coalesces chunks into datagrams of up to BYTES (AGG_MAX_BYTES on the
+// ESP32); compare chunks/s and sendto ns/chunk with small --chunk-bytes.
+//
+// --fec M appends M parity chunks per frame (common/fec.h), as FEC_PARITY does
+// on the ESP32; the parity encode time is reported per data chunk.
+//
+// Loopback loss test: --loss drops that share of datagrams before sendto(),
+// --retx keeps a retransmission cache of N chunks and answers NACKs from the
+// receiver, --fps paces frames like a camera. Against a local receiver:
+//   lvrecv --port 5006 --nack-ms 2 &
+//   fwd_bench --fps 30 --chunks 9000 --loss 0.02 --retx 32
+// lvrecv's frame count shows what made it; fwd_bench prints what it resent.
+//
+// --min-chunks-per-sec makes the run fail (exit 1) below a throughput floor,
+// for catching regressions in CI.
+
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/socket.h>
+
+#include "fwd_core.h"
+#include "sim_transport.h"
+#include "telemetry.h"
+
+#define BENCH_SLOTS 8
+
+typedef struct
+{
+    fwd_core_t *fc;
+    const sim_transport_t *st;
+    bool telemetry;
+    double t0, t_telem;
+    uint32_t telem_seq;
+    // --threads: rx thread -> tx thread, like app_main's s_tx_queue. At most
+    // BENCH_SLOTS slots are out of the transport, so the ring never overflows.
+    pthread_mutex_t lock;
+    pthread_cond_t cv;
+    fwd_slot_t *q[BENCH_SLOTS];
+    double q_time[BENCH_SLOTS];
+    unsigned head, tail;
+    bool rx_done;
+    double wait_sum, wait_max;
+    uint64_t wait_n;
+} bench_t;
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Between paced frames, do what the ESP32's idle tx task does
+static void bench_idle(void *ctx)
+{
+    fwd_poll(ctx);
+}
+
+// Same datagram as app_main's telemetry task; cycles() counts ns here
+static void bench_telemetry(const sim_transport_t *st, const fwd_core_t *fc, uint32_t seq,
+                            double uptime_s)
+{
+    uint32_t fields[TELEM_COUNT] = {0};
+    uint8_t buf[TELEM_LEN];
+    fwd_telemetry_fields(&fc->stats, fields);
+    fields[TELEM_SEQ] = seq;
+    fields[TELEM_UPTIME_MS] = (uint32_t)(uptime_s * 1e3);
+    fields[TELEM_CPU_MHZ] = 1000;
+
+    struct sockaddr_in dst = st->dst;
+    dst.sin_port = htons(ntohs(dst.sin_port) + 1);
+    sendto(st->sock, buf, telem_pack(buf, fields), 0, (struct sockaddr *)&dst, sizeof(dst));
+}
+
+static void bench_tick(bench_t *b)
+{
+    if (b->telemetry && now_s() >= b->t_telem)
+    {
+        bench_telemetry(b->st, b->fc, b->telem_seq++, b->t_telem - b->t0);
+        b->t_telem += 1.0;
+    }
+}
+
+static void *bench_rx_thread(void *arg)
+{
+    bench_t *b = arg;
+    fwd_slot_t *slot;
+    while ((slot = fwd_rx_next(b->fc)) != NULL)
+    {
+        pthread_mutex_lock(&b->lock);
+        b->q_time[b->tail % BENCH_SLOTS] = now_s();
+        b->q[b->tail++ % BENCH_SLOTS] = slot;
+        pthread_cond_signal(&b->cv);
+        pthread_mutex_unlock(&b->lock);
+    }
+    pthread_mutex_lock(&b->lock);
+    b->rx_done = true;
+    pthread_cond_signal(&b->cv);
+    pthread_mutex_unlock(&b->lock);
+    return NULL;
+}
+
+// app_main's udp_tx_task: send what the rx thread queued, poll when idle
+static void bench_tx_loop(bench_t *b)
+{
+    pthread_mutex_lock(&b->lock);
+    for (;;)
+    {
+        if (b->head == b->tail)
+        {
+            if (b->rx_done)
+                break;
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_nsec += 1000000;
+            if (ts.tv_nsec >= 1000000000)
+            {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000;
+            }
+            if (pthread_cond_timedwait(&b->cv, &b->lock, &ts) != 0)
+            {
+                pthread_mutex_unlock(&b->lock);
+                fwd_poll(b->fc);
+                bench_tick(b);
+                pthread_mutex_lock(&b->lock);
+            }
+            continue;
+        }
+        double queued = b->q_time[b->head % BENCH_SLOTS];
+        fwd_slot_t *slot = b->q[b->head++ % BENCH_SLOTS];
+        pthread_mutex_unlock(&b->lock);
+
+        double wait = now_s() - queued;
+        b->wait_sum += wait;
+        b->wait_n++;
+        if (wait > b->wait_max)
+            b->wait_max = wait;
+        fwd_tx(b->fc, slot);
+        bench_tick(b);
+
+        pthread_mutex_lock(&b->lock);
+    }
+    pthread_mutex_unlock(&b->lock);
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--chunks N] [--frame-bytes N] [--chunk-bytes N] [--split]\n"
+            "          [--host IP] [--port N] [--min-chunks-per-sec N] [--fec M]\n"
+            "          [--fps N] [--loss P] [--retx N] [--retx-deadline-ms N]\n"
+            "          [--agg BYTES] [--agg-deadline-us N] [--telemetry]\n"
+            "          [--congest P] [--congest-us N] [--retry-us N] [--backoff-us N]\n"
+            "          [--threads] [--link-kbps N] [--latest] [--stamp] [--stream-id N]\n"
+            "          [--crc] [--flip P] [--sync] [--cut P]\n",
+            argv0);
+}
+
+int main(int argc, char **argv)
+{
+    sim_transport_t st = {
+        .frame_bytes = 12000,
+        .chunk_bytes = 1400,
+        .chunks_left = 200000,
+        .congest_us = 2000,
+    };
+    const char *host = "127.0.0.1";
+    int port = 5006;
+    double min_cps = 0;
+    unsigned fec = 0;
+    unsigned retx = 0;
+    unsigned retx_deadline_ms = 80;
+    unsigned agg = 0;
+    unsigned agg_deadline_us = 1000;
+    bool telemetry = false;
+    unsigned retry_us = 0;
+    unsigned backoff_us = 50;
+    bool threads = false;
+    bool latest = false;
+
+    static const struct option opts[] = {
+        {"chunks", required_argument, NULL, 'n'},
+        {"frame-bytes", required_argument, NULL, 'f'},
+        {"chunk-bytes", required_argument, NULL, 'c'},
+        {"split", no_argument, NULL, 's'},
+        {"host", required_argument, NULL, 'H'},
+        {"port", required_argument, NULL, 'p'},
+        {"min-chunks-per-sec", required_argument, NULL, 'm'},
+        {"fec", required_argument, NULL, 'F'},
+        {"fps", required_argument, NULL, 'r'},
+        {"loss", required_argument, NULL, 'l'},
+        {"retx", required_argument, NULL, 'x'},
+        {"retx-deadline-ms", required_argument, NULL, 'd'},
+        {"agg", required_argument, NULL, 'g'},
+        {"agg-deadline-us", required_argument, NULL, 'u'},
+        {"telemetry", no_argument, NULL, 'T'},
+        {"congest", required_argument, NULL, 'C'},
+        {"congest-us", required_argument, NULL, 'U'},
+        {"retry-us", required_argument, NULL, 'R'},
+        {"backoff-us", required_argument, NULL, 'B'},
+        {"threads", no_argument, NULL, 't'},
+        {"link-kbps", required_argument, NULL, 'k'},
+        {"latest", no_argument, NULL, 'L'},
+        {"stamp", no_argument, NULL, 'S'},
+        {"stream-id", required_argument, NULL, 'I'},
+        {"crc", no_argument, NULL, 'K'},
+        {"flip", required_argument, NULL, 'E'},
+        {"sync", no_argument, NULL, 'Y'},
+        {"cut", required_argument, NULL, 'X'},
+        {NULL, 0, NULL, 0},
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:f:c:sH:p:m:F:r:l:x:d:g:u:TC:U:R:B:tk:LSI:KE:YX:", opts, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            st.chunks_left = strtoull(optarg, NULL, 0);
+            break;
+        case 'f':
+            st.frame_bytes = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'c':
+            st.chunk_bytes = (uint16_t)strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            st.split = true;
+            break;
+        case 'H':
+            host = optarg;
+            break;
+        case 'p':
+            port = atoi(optarg);
+            break;
+        case 'm':
+            min_cps = atof(optarg);
+            break;
+        case 'F':
+            fec = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            st.fps = atof(optarg);
+            break;
+        case 'l':
+            st.loss = atof(optarg);
+            break;
+        case 'x':
+            retx = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+        case 'd':
+            retx_deadline_ms = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+        case 'g':
+            agg = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+        case 'u':
+            agg_deadline_us = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+        case 'T':
+            telemetry = true;
+            break;
+        case 'C':
+            st.congest = atof(optarg);
+            break;
+        case 'U':
+            st.congest_us = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'R':
+            retry_us = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+        case 'B':
+            backoff_us = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+        case 't':
+            threads = true;
+            break;
+        case 'k':
+            st.link_bps = atof(optarg) * 1e3;
+            break;
+        case 'L':
+            latest = true;
+            break;
+        case 'S':
+            st.stamp = true;
+            break;
+        case 'I':
+            st.stream_id = (uint16_t)strtoul(optarg, NULL, 0);
+            st.stamp = true;
+            break;
+        case 'K':
+            st.crc = true;
+            break;
+        case 'E':
+            st.flip = atof(optarg);
+            break;
+        case 'Y':
+            st.sync = true;
+            break;
+        case 'X':
+            st.cut = atof(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    unsigned overhead = (st.stamp ? CHUNK_EXT_LEN : 0) + (st.crc ? CHUNK_CRC_LEN : 0);
+    if (st.chunk_bytes <= overhead || st.chunk_bytes > CHUNK_PAYLOAD_MAX || st.frame_bytes == 0)
+    {
+        fprintf(stderr, "chunk-bytes must be 1..%d (> %d with --stamp, +%d with --crc) and "
+                "frame-bytes > 0\n", CHUNK_PAYLOAD_MAX, CHUNK_EXT_LEN, CHUNK_CRC_LEN);
+        return 2;
+    }
+
+    if (sim_transport_open(&st, host, port) < 0)
+        return 1;
+    uint64_t chunks = st.chunks_left;
+
+    st.threaded = threads;
+    fwd_transport_t io;
+    sim_transport_bind(&st, &io);
+
+    static fwd_slot_t slots[BENCH_SLOTS];
+    for (int i = 0; i < BENCH_SLOTS; i++)
+    {
+        slots[i].buf = malloc(FWD_SLOT_LEN);
+        if (!slots[i].buf)
+        {
+            perror("malloc");
+            return 1;
+        }
+        memset(slots[i].buf, 0xA5, FWD_SLOT_LEN);
+    }
+
+    fwd_core_t fc;
+    fwd_init(&fc, &io, slots, BENCH_SLOTS);
+    fwd_fec_enable(&fc, fec);
+    fwd_agg_enable(&fc, agg, agg_deadline_us * 1000u);
+    fwd_retry_enable(&fc, retry_us * 1000u, backoff_us);
+    fwd_latest_wins(&fc, latest);
+    fwd_stamp_enable(&fc, 1000); // cycles() is in ns here
+    fwd_crc_check(&fc, st.crc ? FWD_CRC_CHECK : FWD_CRC_OFF);
+    if (!threads)
+    {
+        // With --threads the tx thread polls; the rx side must not
+        st.idle = bench_idle;
+        st.idle_ctx = &fc;
+    }
+    uint8_t *retx_mem = NULL;
+    if (retx)
+    {
+        retx_mem = malloc((size_t)retx * FWD_RETX_ENTRY_LEN);
+        if (!retx_mem)
+        {
+            perror("malloc");
+            return 1;
+        }
+        // cycles() is in ns here
+        fwd_retx_enable(&fc, retx_mem, retx, retx_deadline_ms * 1000000u);
+    }
+
+    bench_t b = {.fc = &fc, .st = &st, .telemetry = telemetry};
+    pthread_mutex_init(&b.lock, NULL);
+    pthread_cond_init(&b.cv, NULL);
+    b.t0 = now_s();
+    b.t_telem = b.t0 + 1.0;
+    if (threads)
+    {
+        pthread_t rx;
+        if (pthread_create(&rx, NULL, bench_rx_thread, &b) != 0)
+        {
+            perror("pthread_create");
+            return 1;
+        }
+        bench_tx_loop(&b);
+        pthread_join(rx, NULL);
+    }
+    else
+    {
+        fwd_slot_t *slot;
+        while ((slot = fwd_rx_next(&fc)) != NULL)
+        {
+            fwd_tx(&fc, slot);
+            bench_tick(&b);
+        }
+    }
+    double dt = now_s() - b.t0;
+
+    // Answer the NACKs for the last frames too, flush a trailing aggregate
+    double linger = (retx ? retx_deadline_ms * 1e-3 : 0) + (agg ? 2 * agg_deadline_us * 1e-6 : 0);
+    for (double t_end = now_s() + linger; now_s() < t_end;)
+    {
+        fwd_poll(&fc);
+        struct timespec ts = {0, 100000};
+        nanosleep(&ts, NULL);
+    }
+
+    const fwd_stats_t *s = &fc.stats;
+    double cps = s->tx_chunks / dt;
+    printf("[fwd_bench] %s framing, %u B frames, %u B chunks -> %s:%d\n",
+           st.split ? "split" : "single", st.frame_bytes, st.chunk_bytes, host, port);
+    printf("[fwd_bench] chunks=%u bytes=%u dropped=%u in %.3f s\n",
+           s->tx_chunks, s->tx_bytes, s->rx_dropped, dt);
+    printf("[fwd_bench] %.0f chunks/s  %.2f MB/s  fwd=%u ns/chunk  sendto=%u ns/chunk\n",
+           cps, s->tx_bytes / dt / 1e6,
+           s->tx_chunks ? s->fwd_cycles / s->tx_chunks : 0,
+           s->tx_chunks ? s->send_cycles / s->tx_chunks : 0);
+    if (fc.fec.m)
+        printf("[fwd_bench] fec %u parity/frame (%s): parity=%u skipped=%u fec=%u ns/chunk\n",
+               fc.fec.m, fec_impl(), s->fec_chunks, s->fec_skipped,
+               s->tx_chunks ? s->fec_cycles / s->tx_chunks : 0);
+    if (agg)
+        printf("[fwd_bench] agg %u B: datagrams=%u chunks=%u (%.1f chunks/datagram)\n", agg,
+               s->agg_dgrams, s->agg_chunks,
+               s->agg_dgrams ? (double)s->agg_chunks / s->agg_dgrams : 0.0);
+    if (st.congest > 0 || retry_us)
+        printf("[fwd_bench] congestion: spells=%llu enomem=%u retries=%u given up=%u "
+               "lost=%u shed=%u chunks in %u frames\n",
+               (unsigned long long)st.congest_spells, s->tx_enomem, s->tx_retries, s->tx_errors,
+               s->tx_lost, s->tx_shed, s->frames_shed);
+    if (threads)
+        printf("[fwd_bench] queue wait: mean %.2f ms, max %.2f ms\n",
+               b.wait_n ? b.wait_sum / b.wait_n * 1e3 : 0.0, b.wait_max * 1e3);
+    if (latest)
+        printf("[fwd_bench] latest wins: stale=%u chunks in %u frames\n", s->tx_stale,
+               s->frames_stale);
+    if (st.crc || st.flip > 0)
+        printf("[fwd_bench] crc: flipped=%llu dropped=%u crc=%u ns/chunk\n",
+               (unsigned long long)st.flips, s->rx_crc_bad,
+               s->rx_chunks + s->rx_crc_bad ? s->crc_cycles / (s->rx_chunks + s->rx_crc_bad) : 0);
+    // Chunks that never made it off SPI, against the faults put on it
+    uint64_t faults = st.flips + st.cuts;
+    uint64_t spi_lost = chunks - st.chunks_left - s->rx_chunks;
+    if (st.sync || st.cut > 0)
+        printf("[fwd_bench] link: sync=%s flipped=%llu cut=%llu -> lost=%llu chunks resyncs=%u "
+               "skipped=%u B dropped=%u\n",
+               st.sync ? "on" : "off", (unsigned long long)st.flips, (unsigned long long)st.cuts,
+               (unsigned long long)spi_lost, s->rx_resyncs, s->rx_skipped, s->rx_dropped);
+    if (st.loss > 0 || retx)
+        printf("[fwd_bench] loss shim dropped %llu datagrams; nacks=%u resent=%u miss=%u late=%u\n",
+               (unsigned long long)st.tx_lost, s->nacks, s->retx_chunks, s->retx_miss,
+               s->retx_late);
+
+    sim_transport_close(&st);
+    pthread_mutex_destroy(&b.lock);
+    pthread_cond_destroy(&b.cv);
+    for (int i = 0; i < BENCH_SLOTS; i++)
+        free(slots[i].buf);
+    free(retx_mem);
+
+    if (min_cps > 0 && cps < min_cps)
+    {
+        fprintf(stderr, "[fwd_bench] FAIL: %.0f chunks/s below floor %.0f\n", cps, min_cps);
+        return 1;
+    }
+    if (st.sync && spi_lost > faults)
+    {
+        fprintf(stderr, "[fwd_bench] FAIL: %llu SPI faults cost %llu chunks\n",
+                (unsigned long long)faults, (unsigned long long)spi_lost);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+#!/bin/sh
+# Loopback loss test: fwd_bench drops --loss of its datagrams and answers
+# lvrecv's NACKs from a retransmission cache; fail unless at least MIN_PCT
+# percent of the frames sent come out of lvrecv complete.
+#
+#   loss_test.sh LVRECV FWD_BENCH [MIN_PCT] [PORT]
+#
+# Run by ctest as loss_retx. At 5% loss a 9-chunk frame survives without
+# retransmission only ~63% of the time.
+
+set -u
+LVRECV=$1
+FWD_BENCH=$2
+MIN_PCT=${3:-90}
+PORT=${4:-5116}
+
+FRAMES=200
+CHUNKS_PER_FRAME=9 # 12000 B frames in 1400 B chunks
+LOG=$(mktemp)
+trap 'rm -f "$LOG"' EXIT
+
+"$LVRECV" --port "$PORT" --nack-ms 2 --http-port 0 --out "" >"$LOG" 2>&1 &
+RECV=$!
+sleep 0.5
+
+"$FWD_BENCH" --port "$PORT" --fps 100 --frame-bytes 12000 --chunk-bytes 1400 \
+    --chunks $((FRAMES * CHUNKS_PER_FRAME)) --loss 0.05 --retx 32
+BENCH=$?
+
+# Let the last NACK round finish and the next stats line cover it
+sleep 1.5
+kill -TERM "$RECV"
+wait "$RECV"
+cat "$LOG"
+
+if [ "$BENCH" -ne 0 ]; then
+    echo "loss_test: fwd_bench failed ($BENCH)"
+    exit 1
+fi
+DONE=$(sed -n 's/.* frames=\([0-9]*\) .*/\1/p' "$LOG" | tail -n 1)
+if [ -z "$DONE" ]; then
+    echo "loss_test: no stats from lvrecv"
+    exit 1
+fi
+echo "loss_test: $DONE of $FRAMES frames complete (need $MIN_PCT%)"
+[ $((DONE * 100)) -ge $((FRAMES * MIN_PCT)) ]
@@ -0,0 +1,305 @@
+// host/sim_transport.c
+// Simulated SPI source + POSIX UDP sink for fwd_core
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "crc32.h"
+#include "sim_transport.h"
+
+int sim_transport_open(sim_transport_t *st, const char *host, int port)
+{
+    st->sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (st->sock < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+
+    st->rng = 0x9e3779b9u;
+    pthread_mutex_init(&st->lock, NULL);
+    pthread_cond_init(&st->armed_cv, NULL);
+    memset(&st->dst, 0, sizeof(st->dst));
+    st->dst.sin_family = AF_INET;
+    st->dst.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, host, &st->dst.sin_addr) != 1)
+    {
+        fprintf(stderr, "bad host address: %s\n", host);
+        close(st->sock);
+        st->sock = -1;
+        return -1;
+    }
+    return 0;
+}
+
+void sim_transport_close(sim_transport_t *st)
+{
+    if (st->sock >= 0)
+        close(st->sock);
+    st->sock = -1;
+    pthread_mutex_destroy(&st->lock);
+    pthread_cond_destroy(&st->armed_cv);
+}
+
+static uint64_t sim_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Hold the first chunk of each frame until its frame time
+static void sim_pace(sim_transport_t *st)
+{
+    uint64_t now = sim_now_ns();
+    if (st->next_frame_ns == 0)
+        st->next_frame_ns = now;
+    while (now < st->next_frame_ns)
+    {
+        if (st->idle)
+            st->idle(st->idle_ctx);
+        struct timespec ts = {0, 100000};
+        nanosleep(&ts, NULL);
+        now = sim_now_ns();
+    }
+    st->next_frame_ns += (uint64_t)(1e9 / st->fps);
+}
+
+static void sim_rx_arm(void *ctx, fwd_slot_t *slot)
+{
+    sim_transport_t *st = ctx;
+    if (st->threaded)
+        pthread_mutex_lock(&st->lock);
+    st->armed[st->tail++ % SIM_MAX_SLOTS] = slot;
+    if (st->threaded)
+    {
+        pthread_cond_signal(&st->armed_cv);
+        pthread_mutex_unlock(&st->lock);
+    }
+}
+
+static fwd_slot_t *sim_next_armed(sim_transport_t *st)
+{
+    fwd_slot_t *slot = NULL;
+    if (!st->threaded)
+    {
+        if (st->head != st->tail)
+            slot = st->armed[st->head++ % SIM_MAX_SLOTS];
+        return slot;
+    }
+    pthread_mutex_lock(&st->lock);
+    while (st->head == st->tail)
+        pthread_cond_wait(&st->armed_cv, &st->lock);
+    slot = st->armed[st->head++ % SIM_MAX_SLOTS];
+    pthread_mutex_unlock(&st->lock);
+    return slot;
+}
+
+// xorshift32: the same loss, congestion and bit error pattern on every run
+static uint32_t sim_rand(sim_transport_t *st)
+{
+    st->rng ^= st->rng << 13;
+    st->rng ^= st->rng >> 17;
+    st->rng ^= st->rng << 5;
+    return st->rng;
+}
+
+static bool sim_chance(sim_transport_t *st, double p)
+{
+    return sim_rand(st) < p * 4294967296.0;
+}
+
+// Bit error shim: flip one bit of the transaction as the slave receives it
+static void sim_flip(sim_transport_t *st, uint8_t *rx, uint16_t len)
+{
+    if (st->flip <= 0 || len == 0 || !sim_chance(st, st->flip))
+        return;
+    uint32_t bit = sim_rand(st) % (len * 8u);
+    rx[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+    st->flips++;
+}
+
+// Truncation shim: CS comes up early, anywhere in the transaction; at 0 bytes
+// the transaction is lost altogether, as when the K210 gives up on a chunk
+// after its header. Returns the length the slave sees.
+static uint16_t sim_cut(sim_transport_t *st, uint16_t len)
+{
+    if (st->cut <= 0 || len == 0 || !sim_chance(st, st->cut))
+        return len;
+    st->cuts++;
+    return (uint16_t)(sim_rand(st) % len);
+}
+
+// Write the sender's next transaction into rx; returns its length.
+// Only the header bytes (and the timestamp extension) are written: payload
+// content does not matter to the core, and skipping it keeps the simulator out
+// of the measurement. The CRC trailer covers whatever the slot holds.
+static uint16_t sim_txn(sim_transport_t *st, uint8_t *rx)
+{
+    if (st->payload_next)
+    {
+        // Whatever the slot held before must not pass for a sync word; JPEG
+        // data never does
+        memset(rx, 0, st->payload_len < CHUNK_SYNC_LEN ? st->payload_len : CHUNK_SYNC_LEN);
+        if (st->stamp)
+            chunk_ext_pack(rx, st->stream_id, (uint32_t)((sim_now_ns() - st->capture_ns) / 1000u));
+        if (st->crc)
+        {
+            chunk_hdr_t h;
+            chunk_hdr_parse(st->hdr, &h);
+            chunk_wr32(rx + st->payload_len - CHUNK_CRC_LEN, chunk_crc(&h, rx));
+        }
+        st->payload_next = false;
+        st->chunks_left--;
+        return st->payload_len;
+    }
+
+    if (st->chunk_id == 0)
+    {
+        if (st->fps > 0)
+            sim_pace(st);
+        st->capture_ns = sim_now_ns();
+    }
+
+    // chunk_bytes is the SPI payload; the extension and CRC take their share
+    uint16_t ext = st->stamp ? CHUNK_EXT_LEN : 0;
+    uint16_t trailer = st->crc ? CHUNK_CRC_LEN : 0;
+    uint32_t left = st->frame_bytes - st->off;
+    uint16_t data = (uint16_t)(st->chunk_bytes - ext - trailer);
+    chunk_hdr_t h = {
+        .frame_id = st->frame_id,
+        .chunk_id = st->chunk_id,
+        .flags = (uint8_t)((st->stamp ? CHUNK_FLAG_EXT : 0) | (st->crc ? CHUNK_FLAG_CRC : 0)),
+        .rsv = 0,
+        .payload_len = (uint16_t)(ext + (left < data ? left : data) + trailer),
+    };
+    if (st->chunk_id == 0)
+        h.flags |= CHUNK_FLAG_START;
+    st->off += h.payload_len - ext - trailer;
+    st->chunk_id++;
+    if (st->off >= st->frame_bytes)
+    {
+        h.flags |= CHUNK_FLAG_END;
+        st->frame_id++;
+        st->chunk_id = 0;
+        st->off = 0;
+    }
+
+    uint16_t sync = st->sync ? CHUNK_SYNC_LEN : 0;
+    uint8_t *p = rx + sync;
+    if (sync)
+        chunk_wr32(rx, CHUNK_SYNC_WORD);
+    chunk_hdr_pack(p, &h);
+
+    if (st->split)
+    {
+        memcpy(st->hdr, p, CHUNK_HDR_LEN);
+        st->payload_next = true;
+        st->payload_len = h.payload_len;
+        return (uint16_t)(sync + CHUNK_HDR_LEN);
+    }
+    if (st->stamp)
+        chunk_ext_pack(p + CHUNK_HDR_LEN, st->stream_id,
+                       (uint32_t)((sim_now_ns() - st->capture_ns) / 1000u));
+    if (st->crc)
+        chunk_crc_seal(p);
+    st->chunks_left--;
+    return (uint16_t)(sync + CHUNK_HDR_LEN + h.payload_len);
+}
+
+static fwd_slot_t *sim_rx_wait(void *ctx)
+{
+    sim_transport_t *st = ctx;
+    if (st->chunks_left == 0)
+        return NULL;
+    fwd_slot_t *slot = sim_next_armed(st);
+    if (!slot)
+        return NULL;
+    uint8_t *rx = slot->buf + FWD_SLOT_HEADROOM;
+
+    // A lost transaction leaves the slot armed for the next one
+    uint16_t len;
+    do
+        len = sim_cut(st, sim_txn(st, rx));
+    while (len == 0 && st->chunks_left);
+    sim_flip(st, rx, len);
+    slot->rx_len = len;
+    return slot;
+}
+
+static int sim_tx_send(void *ctx, const uint8_t *buf, size_t len)
+{
+    sim_transport_t *st = ctx;
+    if (st->congest > 0)
+    {
+        uint64_t now = sim_now_ns();
+        if (now < st->congest_until_ns)
+            return -ENOMEM;
+        if (sim_chance(st, st->congest))
+        {
+            st->congest_until_ns = now + (uint64_t)st->congest_us * 1000u;
+            st->congest_spells++;
+            return -ENOMEM;
+        }
+    }
+    if (st->link_bps > 0)
+    {
+        // Wait for the link, then occupy it for this datagram's airtime
+        uint64_t now = sim_now_ns();
+        if (st->link_free_ns > now)
+        {
+            struct timespec ts = {(time_t)(st->link_free_ns / 1000000000u),
+                                  (long)(st->link_free_ns % 1000000000u)};
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        }
+        else
+        {
+            st->link_free_ns = now;
+        }
+        st->link_free_ns += (uint64_t)(len * 8 * 1e9 / st->link_bps);
+    }
+    if (st->loss > 0 && sim_chance(st, st->loss))
+    {
+        st->tx_lost++;
+        return 0;
+    }
+    if (sendto(st->sock, buf, len, 0, (struct sockaddr *)&st->dst, sizeof(st->dst)) < 0)
+        return -errno;
+    return 0;
+}
+
+// Nanoseconds stand in for CPU cycles on the host
+static uint32_t sim_cycles(void *ctx)
+{
+    (void)ctx;
+    return (uint32_t)sim_now_ns();
+}
+
+static void sim_backoff(void *ctx, uint32_t us)
+{
+    (void)ctx;
+    struct timespec ts = {(time_t)(us / 1000000u), (long)(us % 1000000u) * 1000};
+    nanosleep(&ts, NULL);
+}
+
+static int sim_rx_ctrl(void *ctx, uint8_t *buf, size_t cap)
+{
+    sim_transport_t *st = ctx;
+    return (int)recv(st->sock, buf, cap, MSG_DONTWAIT);
+}
+
+void sim_transport_bind(sim_transport_t *st, fwd_transport_t *io)
+{
+    io->ctx = st;
+    io->rx_arm = sim_rx_arm;
+    io->rx_wait = sim_rx_wait;
+    io->tx_send = sim_tx_send;
+    io->cycles = sim_cycles;
+    io->rx_ctrl = sim_rx_ctrl;
+    io->backoff = sim_backoff;
+}
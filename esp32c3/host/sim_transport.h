@@ -0,0 +1,84 @@
+// host/sim_transport.h
+// Linux fwd_transport_t: a simulated SPI master feeding K210-style chunks into
+// the armed slots, and a real UDP socket on the send side.
+//
+// For loopback runs against lvrecv it can also pace frames (fps), drop a share
+// of outgoing datagrams like a lossy link (loss), and hands NACKs that come
+// back on the socket to the core (rx_ctrl). A congestion shim makes tx_send()
+// fail with -ENOMEM for a while, like lwIP with the Wi-Fi TX queue full.
+// link_bps makes tx_send() block for each datagram's airtime, like a slow
+// link. With `threaded` set, rx_arm() may be called from another thread than
+// rx_wait(), which then blocks for an armed slot like the SPI slave driver.
+// With `crc` the chunks carry a CRC trailer (chunk_proto.h CHUNK_FLAG_CRC),
+// and `flip` flips a random bit of that share of SPI transactions, like bit
+// errors on a fast SPI clock. `sync` starts header transactions with the sync
+// word (CHUNK_SYNC_WORD); `cut` ends that share of transactions early, or
+// loses them altogether, like a CS glitch or a sender giving up mid-chunk.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <netinet/in.h>
+
+#include "fwd_core.h"
+
+#define SIM_MAX_SLOTS 64
+
+typedef struct
+{
+    // traffic shape
+    uint32_t frame_bytes; // JPEG size per frame
+    uint16_t chunk_bytes; // CHUNK_PAYLOAD on the K210
+    bool split;           // split framing (header and payload transactions)
+    uint64_t chunks_left; // rx_wait() returns NULL after this many chunks
+    double fps;           // 0 = as fast as the core takes chunks
+    double loss;          // share of datagrams tx_send() silently drops
+    double congest;       // chance per datagram that a congestion spell starts
+    uint32_t congest_us;  // how long tx_send() then returns -ENOMEM
+    double link_bps;      // 0 = as fast as sendto()
+    bool threaded;        // rx and tx on separate threads
+    bool stamp;           // chunks carry the timestamp extension (CHUNK_FLAG_EXT)
+    uint16_t stream_id;   // written into the extension
+    bool crc;             // chunks carry a CRC trailer
+    double flip;          // share of SPI transactions with one bit flipped
+    bool sync;            // header transactions start with the sync word
+    double cut;           // share of SPI transactions cut short (or lost)
+    // Called while rx_wait() waits for the next frame time (may be NULL)
+    void (*idle)(void *idle_ctx);
+    void *idle_ctx;
+
+    // sender state
+    uint32_t frame_id;
+    uint16_t chunk_id;
+    uint32_t off;
+    bool payload_next; // split framing: header sent, payload pending
+    uint16_t payload_len;
+    uint8_t hdr[CHUNK_HDR_LEN]; // split framing: the header as sent, for the CRC
+    uint64_t next_frame_ns;
+    uint64_t capture_ns; // "snapshot" time of the frame being sent
+    uint32_t rng;
+    uint64_t tx_lost; // datagrams dropped by the loss shim
+    uint64_t congest_until_ns;
+    uint64_t congest_spells;
+    uint64_t link_free_ns;
+    uint64_t flips; // bits flipped by the bit error shim
+    uint64_t cuts;  // transactions cut short by the truncation shim
+
+    // armed slots, completed in FIFO order like the SPI slave driver
+    fwd_slot_t *armed[SIM_MAX_SLOTS];
+    unsigned head, tail;
+    pthread_mutex_t lock; // threaded: guards head/tail
+    pthread_cond_t armed_cv;
+
+    int sock;
+    struct sockaddr_in dst;
+} sim_transport_t;
+
+// Open the UDP socket towards host:port; -1 on error
+int sim_transport_open(sim_transport_t *st, const char *host, int port);
+void sim_transport_close(sim_transport_t *st);
+
+// Wire st into io (ctx + callbacks)
+void sim_transport_bind(sim_transport_t *st, fwd_transport_t *io);
@@ -3,26 +3,69 @@
 // - BLE Wi-Fi Provisioning (Espressif "ESP BLE Provisioning" app)
 // - After Wi-Fi connected: SPI SLAVE receives [10B hdr + payload] and forwards via UDP
 // - No JPEG decode, no frame reassembly on ESP32.
+// - Receive is pipelined: RX_SLOTS DMA buffers stay queued in the SPI slave driver
+//   while a separate task does the UDP sendto(), so SPI and Wi-Fi overlap.
+// - Zero-copy: the datagram is sent straight out of the DMA slot.
+// - Framing, slot layout and accounting live in fwd_core.c (host-buildable);
+//   this file supplies the ESP-IDF transport: SPI slave, lwIP UDP, RDY.
+// - NACK retransmission (off by default): the last RETX_CACHE_CHUNKS sent
+//   chunks are kept in RAM; the PC receiver NACKs missing ones back to our UDP
+//   socket and they are resent until RETX_DEADLINE_MS after their frame
+//   started going out.
+// - Congestion: a sendto() that fails because lwIP or the Wi-Fi TX queue is
+//   full is retried with backoff for up to RETRY_DEADLINE_US; a frame that
+//   still loses chunks is shed rather than sent on undecodable.
+// - Latest frame wins: under backlog, a queued frame is skipped once a newer
+//   frame is queued behind it, so stale video does not hold up live video.
+// - Latency stamps: chunks from the K210 that carry the timestamp extension
+//   (chunk_proto.h CHUNK_FLAG_EXT) get our SPI -> sendto() delay written in.
+// - CRC: chunks from the K210 with a CRC trailer (chunk_proto.h
+//   CHUNK_FLAG_CRC) are checked as they come off SPI; garbled ones are dropped
+//   before they are queued, and never cost airtime. The boot log times the
+//   CRC kernels (ROM and table) on a full chunk.
+// - Telemetry: once a second the forwarder's counters (common/telemetry.h) go
+//   to UDP_HOST_PORT + 1 as one small datagram; pc/telemetry.py plots them.
+// - RDY is real flow control: high only while a receive slot is armed in the
+//   SPI hardware, low from the end of each transaction until the next one is
+//   loaded. When every slot is waiting on Wi-Fi TX, RDY stays low.
+// - Resync: a K210 that starts headers with the sync word (chunk_proto.h
+//   CHUNK_SYNC_WORD) loses only the chunk a lost, cut or garbled transaction
+//   hits; fwd_core drops bytes up to the next sync word. Every transaction
+//   clocks our link status back on MISO, whose resync count tells the K210
+//   when that happened. RDY keeps meaning only "slot armed": the K210 times
+//   its waits on it, so a signal folded into its timing would read as
+//   backpressure.
 //
-// SPI protocol: Header = 10 bytes: <I H B B H  (little-endian)
+// SPI protocol: Header = 10 bytes: <I H B B H  (little-endian, chunk_proto.h)
 //   frame_id(u32), chunk_id(u16), flags(u8), rsv(u8), payload_len(u16)
-// Then payload_len bytes follow.
+// Then payload_len bytes follow, either as a second SPI transaction (split
+// framing) or in the same CS-framed transaction as the header (single framing).
+// The header may be preceded by the 4-byte sync word in either framing.
 //
 // Pins (per your table):
 //   SCLK=GPIO4, MISO=GPIO5, MOSI=GPIO6, CS=GPIO7, RDY=GPIO10(output to K210)
 
 #include <string.h>
+#include <stdlib.h>
+#include <errno.h>
 #include <inttypes.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include "freertos/event_groups.h"
 
 #include "esp_log.h"
 #include "esp_err.h"
 #include "esp_mac.h"
+#include "esp_heap_caps.h"
+#include "esp_cpu.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
 
 #include "nvs_flash.h"
 
@@ -32,11 +75,14 @@
 
 #include "driver/gpio.h"
 #include "driver/spi_slave.h"
+#include "soc/gpio_reg.h"
 
 #include "network_provisioning/manager.h"
 #include "network_provisioning/scheme_ble.h"
 
 #include "credential.h" // provides UDP_HOST_IP / UDP_HOST_PORT
+#include "crc32.h"
+#include "fwd_core.h"
 
 static const char *TAG = "app_main.c";
 
@@ -50,9 +96,64 @@ static const char *TAG = "app_main.c";
 #define SPI_HOST SPI2_HOST
 #define DMA_CHAN SPI_DMA_CH_AUTO
 
-// Header = 10 bytes: <I H B B H
-#define HDR_LEN 10
-#define PAYLOAD_MAX 2048
+// Receive pipeline
+// Every slot is one DMA buffer armed as a full-size SPI transaction; the master
+// ends each transaction with CS, so split and single frames all fit.
+// RX_SLOTS=1 degenerates to the old receive-then-send behaviour.
+#define RX_SLOTS 8
+#define TX_TASK_STACK 4096
+#define TX_TASK_PRIO 5
+
+// Log average forward-path cycles every CYCLE_STATS_EVERY chunks (0 = off)
+#define CYCLE_STATS_EVERY 1000
+
+// Reed-Solomon parity chunks appended to every frame (common/fec.h); the PC
+// receiver rebuilds up to this many lost chunks per frame. 0 = off.
+#define FEC_PARITY 0
+
+// NACK retransmission: chunks cached (FWD_RETX_ENTRY_LEN bytes each, 0 = off)
+// and how long a frame stays eligible. Every sent chunk is copied into the
+// cache, and 24 chunks take 49 KB of heap, so it is off until a lossy link
+// (lvrecv --nack-ms) is worth that.
+#define RETX_CACHE_CHUNKS 0
+#define RETX_DEADLINE_MS 80
+
+// Coalesce consecutive chunks of a frame into datagrams of up to AGG_MAX_BYTES
+// (0 = off, <= FWD_AGG_MAX). Worth it when the K210 sends small chunks; an
+// aggregate waits at most AGG_DEADLINE_US for more (tick-rounded when idle).
+#define AGG_MAX_BYTES 0
+#define AGG_DEADLINE_US 1000
+
+// sendto() ENOMEM retries: give up on a datagram after RETRY_DEADLINE_US
+// (0 = no retries), backing off from RETRY_BACKOFF_US. Roughly the airtime of
+// a few full-size frames, so the Wi-Fi queue can drain without stalling SPI
+// for long.
+#define RETRY_DEADLINE_US 3000
+#define RETRY_BACKOFF_US 50
+
+// Skip a queued frame when a newer one is already queued behind it (1 = on)
+#define LATEST_FRAME_WINS 1
+
+// How often the idle sender task checks for NACKs and overdue aggregates
+#define TX_IDLE_POLL_MS 1
+
+// CRC trailer check (common/crc32.h): FWD_CRC_OFF, FWD_CRC_CHECK (drop chunks
+// whose trailer does not match) or FWD_CRC_REQUIRE (also drop chunks without
+// one; only with CRC = True in k210/main.py)
+#define CRC_CHECK FWD_CRC_CHECK
+
+// Telemetry datagram period (0 = off)
+#define TELEMETRY_PERIOD_MS 1000
+#define TELEM_TASK_STACK 3072
+#define TELEM_TASK_PRIO 2
+
+static fwd_slot_t s_slots[RX_SLOTS];
+static spi_slave_transaction_t s_slot_trans[RX_SLOTS];
+// What every transaction clocks out on MISO: the link status
+// (chunk_proto.h) while the K210 sends its sync word, zeros after
+static uint8_t *s_link_status; // FWD_SLOT_RX_ALLOC bytes
+static QueueHandle_t s_tx_queue; // fwd_slot_t* ready for UDP send
+static fwd_core_t s_fwd;
 
 // Wi-Fi connected event bit
 #define WIFI_CONNECTED_BIT BIT0
@@ -64,6 +165,22 @@ static struct sockaddr_in udp_dst;
 
 static inline void set_rdy(int v) { gpio_set_level(PIN_RDY, v); }
 
+// SPI slave ISR callbacks drive RDY directly (SPI_SLAVE_ISR_IN_IRAM is on, so
+// use the W1TS/W1TC registers rather than gpio_set_level()).
+// post_setup: a slot is loaded into the hardware -> ready for the master.
+// post_trans: that slot is full -> not ready until the driver loads the next.
+static void IRAM_ATTR rdy_post_setup_cb(spi_slave_transaction_t *t)
+{
+    (void)t;
+    REG_WRITE(GPIO_OUT_W1TS_REG, BIT(PIN_RDY));
+}
+
+static void IRAM_ATTR rdy_post_trans_cb(spi_slave_transaction_t *t)
+{
+    (void)t;
+    REG_WRITE(GPIO_OUT_W1TC_REG, BIT(PIN_RDY));
+}
+
 // -----------------------------
 // Wi-Fi event handler
 // -----------------------------
@@ -216,7 +333,7 @@ static void spi_slave_init_bus(void)
     io.mode = GPIO_MODE_OUTPUT;
     io.pin_bit_mask = 1ULL << PIN_RDY;
     ESP_ERROR_CHECK(gpio_config(&io));
-    set_rdy(1);
+    set_rdy(0); // raised by rdy_post_setup_cb once a slot is armed
 
     spi_bus_config_t buscfg = {
         .mosi_io_num = PIN_MOSI,
@@ -224,14 +341,16 @@ static void spi_slave_init_bus(void)
         .sclk_io_num = PIN_SCLK,
         .quadwp_io_num = -1,
         .quadhd_io_num = -1,
-        .max_transfer_sz = (PAYLOAD_MAX > HDR_LEN ? PAYLOAD_MAX : HDR_LEN),
+        .max_transfer_sz = FWD_SLOT_RX_ALLOC,
     };
 
     spi_slave_interface_config_t slvcfg = {
         .spics_io_num = PIN_CS,
-        .queue_size = 8,
+        .queue_size = RX_SLOTS,
         .mode = 0,
         .flags = 0,
+        .post_setup_cb = rdy_post_setup_cb,
+        .post_trans_cb = rdy_post_trans_cb,
     };
 
     ESP_ERROR_CHECK(spi_slave_initialize(SPI_HOST, &buscfg, &slvcfg, DMA_CHAN));
@@ -240,46 +359,287 @@ static void spi_slave_init_bus(void)
 }
 
 // -----------------------------
-// SPI -> UDP forwarding loop (no reassembly)
+// ESP-IDF transport for fwd_core
 // -----------------------------
-static void spi_udp_forward_loop(void)
+static void rx_slots_init(void)
+{
+    // Shared by all slots; DMA-capable and as long as the armed transaction
+    // (FWD_SLOT_RX_ALLOC, whole words) so the driver sends it in place rather
+    // than from a copy taken when the slot is queued
+    s_link_status = heap_caps_calloc(1, FWD_SLOT_RX_ALLOC, MALLOC_CAP_DMA);
+    if (!s_link_status)
+    {
+        ESP_LOGE(TAG, "link status: DMA alloc failed");
+        abort();
+    }
+    s_link_status[0] = CHUNK_LINK_STATUS_MAGIC;
+    s_link_status[1] = CHUNK_LINK_STATUS_VERSION;
+
+    for (int i = 0; i < RX_SLOTS; i++)
+    {
+        fwd_slot_t *slot = &s_slots[i];
+        slot->buf = heap_caps_malloc(FWD_SLOT_LEN, MALLOC_CAP_DMA);
+        if (!slot->buf)
+        {
+            ESP_LOGE(TAG, "rx slot %d: DMA alloc failed", i);
+            abort();
+        }
+        slot->priv = &s_slot_trans[i];
+        s_slot_trans[i].user = slot;
+    }
+}
+
+// Queue the slot's buffer as the next SPI receive. Transactions complete in
+// queue order, so re-arming from the UDP task is safe. A slot dropped for a
+// framing error is re-armed right away, so the resync count the K210 reads
+// back is current by its next transaction. Queued transactions may be
+// clocking the status out meanwhile, so the count goes in with one aligned
+// 16-bit store (little-endian, as on the wire), never half-written.
+static void esp_rx_arm(void *ctx, fwd_slot_t *slot)
+{
+    (void)ctx;
+    spi_slave_transaction_t *t = slot->priv;
+    *(volatile uint16_t *)(s_link_status + 2) = (uint16_t)s_fwd.stats.rx_resyncs;
+    t->length = FWD_SLOT_RX_ALLOC * 8;
+    t->trans_len = 0;
+    t->tx_buffer = s_link_status;
+    t->rx_buffer = slot->buf + FWD_SLOT_HEADROOM;
+    ESP_ERROR_CHECK(spi_slave_queue_trans(SPI_HOST, t, portMAX_DELAY));
+}
+
+static fwd_slot_t *esp_rx_wait(void *ctx)
 {
-    uint8_t hdr[HDR_LEN];
-    uint8_t payload[PAYLOAD_MAX];
-    spi_slave_transaction_t t = {0};
+    (void)ctx;
+    spi_slave_transaction_t *t;
+    ESP_ERROR_CHECK(spi_slave_get_trans_result(SPI_HOST, &t, portMAX_DELAY));
+
+    fwd_slot_t *slot = t->user;
+    slot->rx_len = (uint16_t)(t->trans_len / 8);
+    return slot;
+}
+
+static int esp_tx_send(void *ctx, const uint8_t *buf, size_t len)
+{
+    (void)ctx;
+    if (sendto(udp_sock, buf, len, 0, (struct sockaddr *)&udp_dst, sizeof(udp_dst)) < 0)
+        return -errno;
+    return 0;
+}
+
+static uint32_t esp_cycles(void *ctx)
+{
+    (void)ctx;
+    return esp_cpu_get_cycle_count();
+}
+
+static int esp_rx_ctrl(void *ctx, uint8_t *buf, size_t cap)
+{
+    (void)ctx;
+    return recv(udp_sock, buf, cap, MSG_DONTWAIT);
+}
+
+// Spin for short waits (the Wi-Fi task preempts us anyway); sleep for
+// tick-length ones
+static void esp_backoff(void *ctx, uint32_t us)
+{
+    (void)ctx;
+    if (us < 1000u * portTICK_PERIOD_MS)
+        esp_rom_delay_us(us);
+    else
+        vTaskDelay(pdMS_TO_TICKS(us / 1000u));
+}
+
+static const fwd_transport_t s_esp_transport = {
+    .rx_arm = esp_rx_arm,
+    .rx_wait = esp_rx_wait,
+    .tx_send = esp_tx_send,
+    .cycles = esp_cycles,
+    .rx_ctrl = esp_rx_ctrl,
+    .backoff = esp_backoff,
+};
+
+// -----------------------------
+// Forward-path cycle accounting
+// fwd = SPI completion -> datagram ready to send; sendto = the sendto() call
+// -----------------------------
+#if CYCLE_STATS_EVERY
+static void cycle_stats_log(const fwd_stats_t *st)
+{
+    static fwd_stats_t last;
+
+    uint32_t n = st->tx_chunks - last.tx_chunks;
+    if (n < CYCLE_STATS_EVERY)
+        return;
+
+    ESP_LOGI(TAG, "cycles/chunk: fwd=%" PRIu32 " sendto=%" PRIu32 " fec=%" PRIu32
+             " crc=%" PRIu32 " (parity=%" PRIu32 " skipped=%" PRIu32 ")",
+             (st->fwd_cycles - last.fwd_cycles) / n,
+             (st->send_cycles - last.send_cycles) / n,
+             (st->fec_cycles - last.fec_cycles) / n,
+             (st->crc_cycles - last.crc_cycles) / n,
+             st->fec_chunks - last.fec_chunks,
+             st->fec_skipped - last.fec_skipped);
+    if (st->rx_crc_bad != last.rx_crc_bad)
+        ESP_LOGW(TAG, "crc: dropped %" PRIu32 " garbled chunks", st->rx_crc_bad - last.rx_crc_bad);
+    if (st->rx_resyncs != last.rx_resyncs)
+        ESP_LOGW(TAG, "spi: %" PRIu32 " transactions out of step, skipped %" PRIu32 " bytes",
+                 st->rx_resyncs - last.rx_resyncs, st->rx_skipped - last.rx_skipped);
+    if (st->agg_dgrams != last.agg_dgrams)
+        ESP_LOGI(TAG, "agg: datagrams=%" PRIu32 " chunks=%" PRIu32,
+                 st->agg_dgrams - last.agg_dgrams, st->agg_chunks - last.agg_chunks);
+    if (st->tx_enomem != last.tx_enomem || st->tx_errors != last.tx_errors)
+        ESP_LOGW(TAG, "congestion: enomem=%" PRIu32 " retries=%" PRIu32 " given up=%" PRIu32
+                 " lost=%" PRIu32 " shed=%" PRIu32 " frames shed=%" PRIu32,
+                 st->tx_enomem - last.tx_enomem, st->tx_retries - last.tx_retries,
+                 st->tx_errors - last.tx_errors, st->tx_lost - last.tx_lost,
+                 st->tx_shed - last.tx_shed, st->frames_shed - last.frames_shed);
+    if (st->frames_stale != last.frames_stale)
+        ESP_LOGI(TAG, "latest wins: skipped %" PRIu32 " chunks in %" PRIu32 " frames",
+                 st->tx_stale - last.tx_stale, st->frames_stale - last.frames_stale);
+    if (st->nacks != last.nacks)
+        ESP_LOGI(TAG, "retx: nacks=%" PRIu32 " resent=%" PRIu32 " miss=%" PRIu32
+                 " late=%" PRIu32,
+                 st->nacks - last.nacks, st->retx_chunks - last.retx_chunks,
+                 st->retx_miss - last.retx_miss, st->retx_late - last.retx_late);
+    last = *st;
+}
+#endif
+
+// -----------------------------
+// CRC kernels on this chip: cycles for one CHUNK_PAYLOAD_MAX buffer each
+// (best of a few runs, so an interrupt does not count), and a check that they
+// all agree with the standard check value
+// -----------------------------
+#if CRC_CHECK
+static void crc_bench_log(void)
+{
+    static const struct
+    {
+        const char *name;
+        uint32_t (*fn)(uint32_t, const void *, size_t);
+    } kernels[] = {
+        {"bytewise", crc32_ieee_bytewise},
+        {"slice-by-8", crc32_ieee_slice8},
+        {CRC32_USE_ROM ? "rom" : "crc32_ieee", crc32_ieee},
+    };
+    uint8_t *buf = malloc(CHUNK_PAYLOAD_MAX);
+    if (!buf)
+        return;
+    for (int i = 0; i < CHUNK_PAYLOAD_MAX; i++)
+        buf[i] = (uint8_t)(i * 131 + 7);
+
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+    {
+        uint32_t best = UINT32_MAX;
+        for (int rep = 0; rep < 8; rep++)
+        {
+            uint32_t c0 = esp_cpu_get_cycle_count();
+            kernels[k].fn(0, buf, CHUNK_PAYLOAD_MAX);
+            uint32_t dc = esp_cpu_get_cycle_count() - c0;
+            if (dc < best)
+                best = dc;
+        }
+        bool ok = kernels[k].fn(0, "123456789", 9) == CRC32_CHECK_VALUE;
+        ESP_LOGI(TAG, "crc32 %s: %" PRIu32 " cycles per %d B (%" PRIu32 ".%" PRIu32 " cycles/B)%s",
+                 kernels[k].name, best, CHUNK_PAYLOAD_MAX, best / CHUNK_PAYLOAD_MAX,
+                 best * 10 / CHUNK_PAYLOAD_MAX % 10, ok ? "" : " WRONG CHECK VALUE");
+    }
+    free(buf);
+}
+#endif
+
+// -----------------------------
+// UDP sender task: drains completed slots, hands buffers back to SPI
+// -----------------------------
+static void udp_tx_task(void *arg)
+{
+    (void)arg;
+    fwd_slot_t *slot;
+
+    while (1)
+    {
+        if (xQueueReceive(s_tx_queue, &slot, pdMS_TO_TICKS(TX_IDLE_POLL_MS)) != pdTRUE)
+        {
+            // Nothing new to send: flush a waiting aggregate, do retransmits
+            fwd_poll(&s_fwd);
+            continue;
+        }
+        fwd_tx(&s_fwd, slot);
+#if CYCLE_STATS_EVERY
+        cycle_stats_log(&s_fwd.stats);
+#endif
+    }
+}
+
+// -----------------------------
+// Telemetry: snapshot the counters, one datagram per period. The counters have
+// a single writer each (fwd_core.h), so copying them needs no lock.
+// -----------------------------
+static volatile uint32_t s_backlog_sum; // written by the rx loop only
+
+#if TELEMETRY_PERIOD_MS
+static void telemetry_task(void *arg)
+{
+    (void)arg;
+    struct sockaddr_in dst = udp_dst;
+    dst.sin_port = htons(UDP_HOST_PORT + 1);
+    uint32_t fields[TELEM_COUNT];
+    uint8_t buf[TELEM_LEN];
+    uint32_t seq = 0;
+    TickType_t wake = xTaskGetTickCount();
 
     while (1)
     {
-        set_rdy(1);
-
-        // Receive header (10 bytes)
-        memset(&t, 0, sizeof(t));
-        memset(hdr, 0, sizeof(hdr));
-        t.length = HDR_LEN * 8;
-        t.rx_buffer = hdr;
-        ESP_ERROR_CHECK(spi_slave_transmit(SPI_HOST, &t, portMAX_DELAY));
-
-        // payload_len is last 2 bytes (little-endian)
-        uint16_t payload_len = (uint16_t)(hdr[8] | ((uint16_t)hdr[9] << 8));
-        if (payload_len > PAYLOAD_MAX)
-            payload_len = PAYLOAD_MAX;
-
-        set_rdy(1);
-
-        // Receive payload
-        memset(&t, 0, sizeof(t));
-        memset(payload, 0, sizeof(payload));
-        t.length = payload_len * 8;
-        t.rx_buffer = payload;
-        ESP_ERROR_CHECK(spi_slave_transmit(SPI_HOST, &t, portMAX_DELAY));
-
-        // Forward via UDP: [hdr + payload]
-        uint8_t out[HDR_LEN + PAYLOAD_MAX];
-        memcpy(out, hdr, HDR_LEN);
-        memcpy(out + HDR_LEN, payload, payload_len);
-
-        sendto(udp_sock, out, HDR_LEN + payload_len, 0,
-               (struct sockaddr *)&udp_dst, sizeof(udp_dst));
+        xTaskDelayUntil(&wake, pdMS_TO_TICKS(TELEMETRY_PERIOD_MS));
+
+        fwd_stats_t st = s_fwd.stats;
+        fwd_telemetry_fields(&st, fields);
+        fields[TELEM_SEQ] = seq++;
+        fields[TELEM_UPTIME_MS] = (uint32_t)(esp_timer_get_time() / 1000);
+        fields[TELEM_CPU_MHZ] = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+        fields[TELEM_BACKLOG_SUM] = s_backlog_sum;
+        fields[TELEM_FREE_HEAP] = esp_get_free_heap_size();
+
+        size_t len = telem_pack(buf, fields);
+        sendto(udp_sock, buf, len, 0, (struct sockaddr *)&dst, sizeof(dst));
+    }
+}
+#endif
+
+// -----------------------------
+// SPI -> UDP forwarding loop (no reassembly)
+// -----------------------------
+static void spi_udp_forward_loop(void)
+{
+    s_tx_queue = xQueueCreate(RX_SLOTS, sizeof(fwd_slot_t *));
+    rx_slots_init();
+    fwd_init(&s_fwd, &s_esp_transport, s_slots, RX_SLOTS);
+    fwd_fec_enable(&s_fwd, FEC_PARITY);
+    fwd_agg_enable(&s_fwd, AGG_MAX_BYTES, AGG_DEADLINE_US * CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+    fwd_retry_enable(&s_fwd, RETRY_DEADLINE_US * CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+                     RETRY_BACKOFF_US);
+    fwd_latest_wins(&s_fwd, LATEST_FRAME_WINS);
+    fwd_stamp_enable(&s_fwd, CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+    fwd_crc_check(&s_fwd, CRC_CHECK);
+#if RETX_CACHE_CHUNKS
+    uint8_t *retx_mem = malloc((size_t)RETX_CACHE_CHUNKS * FWD_RETX_ENTRY_LEN);
+    if (retx_mem)
+        fwd_retx_enable(&s_fwd, retx_mem, RETX_CACHE_CHUNKS,
+                        RETX_DEADLINE_MS * 1000u * CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+    else
+        ESP_LOGW(TAG, "no memory for the retransmission cache, NACKs ignored");
+#endif
+    xTaskCreate(udp_tx_task, "udp_tx", TX_TASK_STACK, NULL, TX_TASK_PRIO, NULL);
+#if TELEMETRY_PERIOD_MS
+    xTaskCreate(telemetry_task, "telemetry", TELEM_TASK_STACK, NULL, TELEM_TASK_PRIO, NULL);
+#endif
+
+    fwd_slot_t *slot;
+    while ((slot = fwd_rx_next(&s_fwd)) != NULL)
+    {
+        // Chunks already waiting for Wi-Fi: how far TX lags behind SPI
+        s_backlog_sum += uxQueueMessagesWaiting(s_tx_queue);
+        xQueueSend(s_tx_queue, &slot, portMAX_DELAY);
     }
 }
 
@@ -316,6 +676,9 @@ void app_main(void)
     // Safe deinit (if not already deinit'ed inside provisioning path)
     network_prov_mgr_deinit();
 
+#if CRC_CHECK
+    crc_bench_log();
+#endif
     udp_init();
     spi_slave_init_bus();
     spi_udp_forward_loop();
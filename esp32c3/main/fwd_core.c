@@ -0,0 +1,653 @@
+// main/fwd_core.c
+// SPI -> UDP forwarding core (no ESP-IDF dependencies)
+//
+// Both SPI framings are accepted without configuration: a 10-byte transaction
+// is a split header (its payload is the next transaction), a longer one whose
+// payload_len matches its length is a single frame. Either may start with the
+// sync word (chunk_proto.h CHUNK_SYNC_WORD); senders that use it can be picked
+// up again mid-transaction after a framing error (fwd_rx_hunt()).
+//
+// FEC parity (fec.h) is computed on the tx side, after each chunk has been
+// sent, so it adds nothing to a data chunk's latency; parity goes out from
+// buffers inside fwd_core_t once the END chunk's slot is back with SPI.
+//
+// NACK retransmission copies each data chunk into the cache ring after it is
+// sent and answers NACKs between chunks, again after the slot is re-armed.
+//
+// Aggregation copies chunks into one pending datagram and re-arms their slots
+// at once; a chunk that would go out alone anyway (END with nothing pending,
+// or too big) is still sent zero-copy from its slot.
+//
+// Congestion: a send that fails with a full lwIP/Wi-Fi queue is retried with
+// backoff up to a deadline. A frame that has lost more data chunks than its
+// parity covers cannot be decoded, so its remaining chunks are shed rather
+// than spent on airtime. NACK resends are not counted on here: they would
+// only add to the congestion.
+//
+// Latest frame wins: the rx side notes each START's frame_id in rx_newest; when
+// a START reaches the tx side, a newer rx_newest (serial-number order, so
+// frame_id wrap is fine) means a newer frame is already queued behind this
+// one, and this one is skipped whole. Cutting off frames that are already going
+// out instead would, on a link slower than the camera, leave every frame
+// incomplete. A restarted sender's lower frame_ids simply become the newest.
+//
+// CRC (chunk_proto.h CHUNK_FLAG_CRC): checked on the rx side as soon as a
+// chunk is whole, so a chunk garbled on SPI never reaches the tx queue, let
+// alone the air. Its slot goes straight back, like a malformed transaction.
+
+#include <errno.h>
+#include <string.h>
+
+#include "crc32.h"
+#include "fwd_core.h"
+
+static inline uint32_t fwd_cycles(const fwd_core_t *fc)
+{
+    return fc->io->cycles ? fc->io->cycles(fc->io->ctx) : 0;
+}
+
+static inline bool fwd_congested(int err)
+{
+    return err == -ENOMEM || err == -ENOBUFS || err == -EAGAIN;
+}
+
+// Every datagram goes out through here: retries, send time, bytes and errors
+static int fwd_send(fwd_core_t *fc, const uint8_t *buf, size_t len)
+{
+    const fwd_transport_t *io = fc->io;
+    uint32_t backoff = fc->retry_backoff;
+
+    uint32_t c0 = fwd_cycles(fc);
+    int err;
+    while ((err = io->tx_send(io->ctx, buf, len)) != 0 && fwd_congested(err))
+    {
+        fc->stats.tx_enomem++;
+        if (!fc->retry_deadline || fwd_cycles(fc) - c0 >= fc->retry_deadline)
+            break;
+        io->backoff(io->ctx, backoff);
+        fc->stats.tx_retries++;
+        if (backoff < FWD_BACKOFF_MAX_US)
+            backoff *= 2;
+    }
+    fc->stats.send_cycles += fwd_cycles(fc) - c0;
+
+    if (err == 0)
+    {
+        fc->stats.tx_dgrams++;
+        fc->stats.tx_bytes += len;
+    }
+    else
+    {
+        fc->stats.tx_errors++;
+    }
+    return err;
+}
+
+static inline bool fwd_shedding(const fwd_core_t *fc, uint32_t frame_id)
+{
+    return fc->lost_n > fc->fec.m && fc->lost_frame == frame_id;
+}
+
+static void fwd_agg_drop(fwd_core_t *fc);
+
+// n data chunks of frame_id did not go out
+static void fwd_tx_lost(fwd_core_t *fc, uint32_t frame_id, unsigned n)
+{
+    fc->stats.tx_lost += n;
+    if (fc->lost_frame != frame_id)
+    {
+        fc->lost_frame = frame_id;
+        fc->lost_n = 0;
+    }
+    bool was_shedding = fwd_shedding(fc, frame_id);
+    fc->lost_n += n;
+    if (!was_shedding && fwd_shedding(fc, frame_id))
+    {
+        fc->stats.frames_shed++;
+        if (fc->agg_len && chunk_rd32(fc->agg) == frame_id)
+            fwd_agg_drop(fc);
+    }
+}
+
+// Decided at each START: is a newer frame already queued behind this one?
+static bool fwd_stale(fwd_core_t *fc, const fwd_slot_t *slot, uint32_t frame_id)
+{
+    if (!fc->latest_wins)
+        return false;
+    if (slot->dgram[6] & CHUNK_FLAG_START)
+    {
+        fc->stale = (int32_t)(fc->rx_newest - frame_id) > 0;
+        fc->stale_frame = frame_id;
+        if (fc->stale)
+            fc->stats.frames_stale++;
+    }
+    return fc->stale && fc->stale_frame == frame_id;
+}
+
+void fwd_init(fwd_core_t *fc, const fwd_transport_t *io, fwd_slot_t *slots, int n_slots)
+{
+    memset(fc, 0, sizeof(*fc));
+    fc->io = io;
+    fc->expect_hdr = true;
+
+    for (int i = 0; i < n_slots; i++)
+    {
+        io->rx_arm(io->ctx, &slots[i]);
+    }
+}
+
+// What fwd_rx_take() found
+enum
+{
+    FWD_TAKE_NONE,
+    FWD_TAKE_HDR,   // split header, now pending in fc->hdr
+    FWD_TAKE_CHUNK, // [hdr|payload], now the slot's datagram
+};
+
+// A header the K210 could have sent: parity, aggregates and resends only ever
+// come from the forwarder, and every chunk has some payload
+static bool fwd_hdr_ok(const uint8_t *hdr)
+{
+    uint16_t payload_len = chunk_hdr_payload_len(hdr);
+    return payload_len && payload_len <= CHUNK_PAYLOAD_MAX &&
+           !(hdr[6] & (CHUNK_FLAG_AGG | CHUNK_FLAG_RETX));
+}
+
+// p[0..n) is a transaction (or its tail) with any sync word already stripped
+static int fwd_rx_take(fwd_core_t *fc, fwd_slot_t *slot, uint8_t *p, size_t n)
+{
+    if (n < CHUNK_HDR_LEN || !fwd_hdr_ok(p))
+        return FWD_TAKE_NONE;
+    if (n == CHUNK_HDR_LEN)
+    {
+        // Split header: keep it, the buffer goes straight back
+        memcpy(fc->hdr, p, CHUNK_HDR_LEN);
+        fc->expect_hdr = false;
+        return FWD_TAKE_HDR;
+    }
+    if (chunk_hdr_payload_len(p) != n - CHUNK_HDR_LEN)
+        return FWD_TAKE_NONE;
+
+    // Single frame: [hdr|payload] already contiguous
+    slot->dgram = p;
+    slot->dgram_len = (uint16_t)n;
+    return FWD_TAKE_CHUNK;
+}
+
+// Out of step: skip to a sync word that starts a header or a chunk running to
+// the end of the transaction (two transactions run together, the tail of a
+// cut one...), or drop the whole transaction
+static bool fwd_rx_hunt(fwd_core_t *fc, fwd_slot_t *slot, uint8_t *rx, size_t len)
+{
+    uint8_t *end = rx + len;
+
+    for (uint8_t *p = rx + 1; end - p >= CHUNK_SYNC_LEN + CHUNK_HDR_LEN; p++)
+    {
+        p = memchr(p, (int)(CHUNK_SYNC_WORD & 0xFF), (size_t)(end - p));
+        if (!p || end - p < CHUNK_SYNC_LEN + CHUNK_HDR_LEN)
+            break;
+        if (chunk_rd32(p) != CHUNK_SYNC_WORD)
+            continue;
+        int got = fwd_rx_take(fc, slot, p + CHUNK_SYNC_LEN, (size_t)(end - p) - CHUNK_SYNC_LEN);
+        if (got != FWD_TAKE_NONE)
+        {
+            fc->stats.rx_skipped += (uint32_t)(p - rx);
+            return got == FWD_TAKE_CHUNK;
+        }
+    }
+    fc->stats.rx_dropped++;
+    fc->stats.rx_skipped += (uint32_t)len;
+    return false;
+}
+
+// Returns true if the slot now holds a datagram
+static bool fwd_rx_frame(fwd_core_t *fc, fwd_slot_t *slot)
+{
+    uint8_t *rx = slot->buf + FWD_SLOT_HEADROOM;
+    size_t rx_len = slot->rx_len;
+    bool sync = rx_len >= CHUNK_SYNC_LEN && chunk_rd32(rx) == CHUNK_SYNC_WORD;
+    bool resynced = false;
+
+    if (!fc->expect_hdr)
+    {
+        fc->expect_hdr = true;
+        uint16_t payload_len = chunk_hdr_payload_len(fc->hdr);
+        if (!sync && rx_len == payload_len)
+        {
+            // Split payload: put the header in the headroom right in front of it
+            slot->dgram = rx - CHUNK_HDR_LEN;
+            memcpy(slot->dgram, fc->hdr, CHUNK_HDR_LEN);
+            slot->dgram_len = (uint16_t)(CHUNK_HDR_LEN + payload_len);
+            return true;
+        }
+        // Not the payload: its chunk is lost, but this may be the next header
+        fc->stats.rx_resyncs++;
+        fc->stats.rx_skipped += CHUNK_HDR_LEN;
+        resynced = true;
+    }
+
+    int got = sync ? fwd_rx_take(fc, slot, rx + CHUNK_SYNC_LEN, rx_len - CHUNK_SYNC_LEN)
+                   : fwd_rx_take(fc, slot, rx, rx_len);
+    if (got != FWD_TAKE_NONE)
+        return got == FWD_TAKE_CHUNK;
+    if (!resynced)
+        fc->stats.rx_resyncs++;
+    return fwd_rx_hunt(fc, slot, rx, rx_len);
+}
+
+// Chunk passes the CRC policy (fwd_crc_check())
+static bool fwd_rx_crc_ok(fwd_core_t *fc, const fwd_slot_t *slot)
+{
+    chunk_hdr_t h;
+
+    chunk_hdr_parse(slot->dgram, &h);
+    if (!(h.flags & CHUNK_FLAG_CRC))
+        return fc->crc_mode != FWD_CRC_REQUIRE;
+    uint32_t c0 = fwd_cycles(fc);
+    bool ok = chunk_crc_ok(&h, slot->dgram + CHUNK_HDR_LEN);
+    fc->stats.crc_cycles += fwd_cycles(fc) - c0;
+    return ok;
+}
+
+fwd_slot_t *fwd_rx_next(fwd_core_t *fc)
+{
+    const fwd_transport_t *io = fc->io;
+    fwd_slot_t *slot;
+
+    for (;;)
+    {
+        uint32_t w0 = fwd_cycles(fc);
+        slot = io->rx_wait(io->ctx);
+        uint32_t c0 = fwd_cycles(fc);
+        fc->stats.spi_wait_cycles += c0 - w0;
+        if (!slot)
+            return NULL;
+
+        if (fwd_rx_frame(fc, slot))
+        {
+            if (fc->crc_mode && !fwd_rx_crc_ok(fc, slot))
+            {
+                fc->stats.rx_crc_bad++;
+                io->rx_arm(io->ctx, slot);
+                continue;
+            }
+            slot->rx_cycles = c0;
+            slot->fwd_cycles = fwd_cycles(fc) - c0;
+            fc->stats.rx_chunks++;
+            fc->stats.rx_bytes += slot->dgram_len;
+            if (slot->dgram[6] & CHUNK_FLAG_START)
+                fc->rx_newest = chunk_rd32(slot->dgram);
+            return slot;
+        }
+        io->rx_arm(io->ctx, slot);
+    }
+}
+
+void fwd_fec_enable(fwd_core_t *fc, unsigned parity)
+{
+    uint8_t *bufs[FWD_FEC_MAX];
+
+    if (parity > FWD_FEC_MAX)
+        parity = FWD_FEC_MAX;
+    for (unsigned j = 0; j < parity; j++)
+        bufs[j] = fc->fec_dgram[j] + CHUNK_HDR_LEN;
+    fec_enc_init(&fc->fec, parity, bufs);
+}
+
+// Fold the chunk into the frame's parity; true if it completed the frame
+static bool fwd_fec_add(fwd_core_t *fc, const fwd_slot_t *slot)
+{
+    fec_enc_t *e = &fc->fec;
+    chunk_hdr_t h;
+
+    chunk_hdr_parse(slot->dgram, &h);
+    if (h.flags & CHUNK_FLAG_START)
+    {
+        if (e->active)
+            fc->stats.fec_skipped++; // previous frame never reached END
+        fec_enc_begin(e, h.frame_id);
+    }
+
+    // Parity covers the frame data, not the timestamp extension or the CRC
+    const uint8_t *payload = slot->dgram + CHUNK_HDR_LEN;
+    uint16_t skip = chunk_ext_skip(h.flags, payload, h.payload_len);
+    uint16_t trailer = chunk_trailer_len(h.flags);
+    if (skip + trailer > h.payload_len)
+        skip = trailer = 0;
+    bool was_active = e->active;
+    if (!fec_enc_add(e, h.frame_id, h.chunk_id, payload + skip,
+                     (uint16_t)(h.payload_len - skip - trailer)))
+    {
+        if (was_active)
+            fc->stats.fec_skipped++;
+        return false;
+    }
+    if (!(h.flags & CHUNK_FLAG_END))
+        return false;
+
+    e->active = false;
+    return true;
+}
+
+static void fwd_fec_send(fwd_core_t *fc)
+{
+    const fec_enc_t *e = &fc->fec;
+
+    for (unsigned j = 0; j < e->m; j++)
+    {
+        chunk_hdr_t h = {
+            .frame_id = e->frame_id,
+            .chunk_id = (uint16_t)(e->n + j),
+            .flags = 0,
+            .rsv = chunk_rsv_parity(j, e->m),
+            .payload_len = e->len,
+        };
+        chunk_hdr_pack(fc->fec_dgram[j], &h);
+        fwd_send(fc, fc->fec_dgram[j], CHUNK_HDR_LEN + e->len);
+        fc->stats.fec_chunks++;
+    }
+}
+
+void fwd_retx_enable(fwd_core_t *fc, uint8_t *mem, unsigned n_entries, uint32_t deadline)
+{
+    fc->retx_mem = mem;
+    fc->retx_n = (uint16_t)(mem && n_entries <= UINT16_MAX ? n_entries : 0);
+    fc->retx_pos = 0;
+    fc->retx_deadline = deadline;
+    fc->retx_cur = 0;
+    memset(fc->retx_frames, 0, sizeof(fc->retx_frames));
+}
+
+static void fwd_retx_cache(fwd_core_t *fc, const fwd_slot_t *slot)
+{
+    chunk_hdr_t h;
+    chunk_hdr_parse(slot->dgram, &h);
+
+    fwd_retx_frame_t *f = &fc->retx_frames[fc->retx_cur];
+    if (h.flags & CHUNK_FLAG_START)
+    {
+        fc->retx_cur = (fc->retx_cur + 1) % FWD_RETX_FRAMES;
+        f = &fc->retx_frames[fc->retx_cur];
+        f->frame_id = h.frame_id;
+        f->pos = fc->retx_pos;
+        f->sent = fwd_cycles(fc);
+        f->valid = true;
+    }
+    // A chunk lost before the tx side breaks the position mapping for the
+    // rest of the frame; those chunks are simply not cached
+    if (!f->valid || f->frame_id != h.frame_id || f->pos + h.chunk_id != fc->retx_pos)
+        return;
+
+    uint8_t *e = fc->retx_mem + (size_t)(fc->retx_pos % fc->retx_n) * FWD_RETX_ENTRY_LEN;
+    chunk_wr16(e, slot->dgram_len);
+    memcpy(e + 2, slot->dgram, slot->dgram_len);
+    fc->retx_pos++;
+}
+
+// Cached datagram for (frame, chunk_id), or NULL
+static uint8_t *fwd_retx_lookup(fwd_core_t *fc, const fwd_retx_frame_t *f, uint16_t chunk_id)
+{
+    uint32_t pos = f->pos + chunk_id;
+    if (fc->retx_pos - pos - 1 >= fc->retx_n)
+        return NULL; // not written yet, or overwritten
+    uint8_t *e = fc->retx_mem + (size_t)(pos % fc->retx_n) * FWD_RETX_ENTRY_LEN;
+    if (chunk_rd32(e + 2) != f->frame_id || chunk_rd16(e + 2 + 4) != chunk_id)
+        return NULL;
+    return e;
+}
+
+static void fwd_retx_answer(fwd_core_t *fc, const chunk_nack_t *nk)
+{
+    const fwd_retx_frame_t *f = NULL;
+    unsigned asked = 0;
+
+    for (unsigned i = 0; i < FWD_RETX_FRAMES; i++)
+    {
+        if (fc->retx_frames[i].valid && fc->retx_frames[i].frame_id == nk->frame_id)
+            f = &fc->retx_frames[i];
+    }
+    for (unsigned i = 0; i < nk->nbytes * 8u; i++)
+        asked += (nk->bitmap[i / 8] >> (i % 8)) & 1;
+
+    if (!f)
+    {
+        fc->stats.retx_miss += asked;
+        return;
+    }
+    if (fwd_cycles(fc) - f->sent > fc->retx_deadline)
+    {
+        fc->stats.retx_late += asked;
+        return;
+    }
+
+    for (unsigned i = 0; i < nk->nbytes * 8u; i++)
+    {
+        if (!((nk->bitmap[i / 8] >> (i % 8)) & 1))
+            continue;
+        uint8_t *e = fwd_retx_lookup(fc, f, (uint16_t)(nk->base + i));
+        if (!e)
+        {
+            fc->stats.retx_miss++;
+            continue;
+        }
+        uint8_t *dgram = e + 2;
+        dgram[6] |= CHUNK_FLAG_RETX;
+        fwd_send(fc, dgram, chunk_rd16(e));
+        fc->stats.retx_chunks++;
+    }
+}
+
+static void fwd_retx_poll(fwd_core_t *fc)
+{
+    const fwd_transport_t *io = fc->io;
+    uint8_t buf[CHUNK_NACK_HDR_LEN + CHUNK_NACK_BITMAP_MAX];
+    chunk_nack_t nk;
+    int len;
+
+    if (!fc->retx_n || !io->rx_ctrl)
+        return;
+    while ((len = io->rx_ctrl(io->ctx, buf, sizeof(buf))) > 0)
+    {
+        if (chunk_nack_parse(buf, (size_t)len, &nk) != 0)
+            continue;
+        fc->stats.nacks++;
+        fwd_retx_answer(fc, &nk);
+    }
+}
+
+void fwd_agg_enable(fwd_core_t *fc, unsigned max_bytes, uint32_t deadline)
+{
+    if (max_bytes > FWD_AGG_MAX)
+        max_bytes = FWD_AGG_MAX;
+    // Without cycles() a deadline never passes and a partial aggregate of the
+    // last frame would sit unsent
+    if (deadline && !fc->io->cycles)
+        max_bytes = 0;
+    // Room for the outer header and at least one sub-chunk
+    fc->agg_max = (uint16_t)(max_bytes > CHUNK_HDR_LEN + CHUNK_AGG_SUBHDR_LEN ? max_bytes : 0);
+    fc->agg_deadline = deadline;
+    fc->agg_len = 0;
+    fc->agg_count = 0;
+}
+
+static void fwd_agg_flush(fwd_core_t *fc)
+{
+    if (!fc->agg_len)
+        return;
+    fc->agg[7] = fc->agg_count;
+    chunk_wr16(fc->agg + 8, (uint16_t)(fc->agg_len - CHUNK_HDR_LEN));
+
+    if (fwd_send(fc, fc->agg, fc->agg_len) == 0)
+    {
+        fc->stats.agg_dgrams++;
+        fc->stats.agg_chunks += fc->agg_count;
+    }
+    else
+    {
+        fwd_tx_lost(fc, chunk_rd32(fc->agg), fc->agg_count);
+    }
+    fc->agg_len = 0;
+    fc->agg_count = 0;
+}
+
+// The pending aggregate's frame is being shed
+static void fwd_agg_drop(fwd_core_t *fc)
+{
+    fc->stats.tx_shed += fc->agg_count;
+    fc->agg_len = 0;
+    fc->agg_count = 0;
+}
+
+// Copy the slot's chunk into the pending aggregate; false if it has to go out
+// on its own
+static bool fwd_agg_add(fwd_core_t *fc, const fwd_slot_t *slot)
+{
+    chunk_hdr_t h;
+    chunk_hdr_parse(slot->dgram, &h);
+    uint16_t len = (uint16_t)(slot->dgram_len - CHUNK_HDR_LEN);
+    unsigned need = CHUNK_AGG_SUBHDR_LEN + len;
+
+    if (fc->agg_len && (chunk_rd32(fc->agg) != h.frame_id || fc->agg_len + need > fc->agg_max ||
+                        fc->agg_count == UINT8_MAX))
+    {
+        fwd_agg_flush(fc);
+        if (fwd_shedding(fc, h.frame_id))
+        {
+            fc->stats.tx_shed++; // that flush lost the frame
+            return true;
+        }
+    }
+    if (CHUNK_HDR_LEN + need > fc->agg_max || (!fc->agg_len && (h.flags & CHUNK_FLAG_END)))
+        return false;
+
+    if (!fc->agg_len)
+    {
+        chunk_hdr_t outer = {
+            .frame_id = h.frame_id,
+            .chunk_id = h.chunk_id,
+            .flags = CHUNK_FLAG_AGG,
+        };
+        chunk_hdr_pack(fc->agg, &outer);
+        fc->agg_len = CHUNK_HDR_LEN;
+        fc->agg_started = fwd_cycles(fc);
+    }
+    h.payload_len = len;
+    chunk_agg_sub_pack(fc->agg + fc->agg_len, &h);
+    memcpy(fc->agg + fc->agg_len + CHUNK_AGG_SUBHDR_LEN, slot->dgram + CHUNK_HDR_LEN, len);
+    fc->agg_len = (uint16_t)(fc->agg_len + need);
+    fc->agg_count++;
+
+    if (h.flags & CHUNK_FLAG_END)
+        fwd_agg_flush(fc);
+    return true;
+}
+
+void fwd_poll(fwd_core_t *fc)
+{
+    if (fc->agg_len && fwd_cycles(fc) - fc->agg_started >= fc->agg_deadline)
+        fwd_agg_flush(fc);
+    fwd_retx_poll(fc);
+}
+
+void fwd_tx(fwd_core_t *fc, fwd_slot_t *slot)
+{
+    const fwd_transport_t *io = fc->io;
+    uint32_t frame_id = chunk_rd32(slot->dgram);
+
+    bool shed = fwd_shedding(fc, frame_id);
+    if (shed || fwd_stale(fc, slot, frame_id))
+    {
+        fc->stats.tx_chunks++;
+        if (shed)
+            fc->stats.tx_shed++;
+        else
+            fc->stats.tx_stale++;
+        io->rx_arm(io->ctx, slot);
+        fwd_poll(fc);
+        return;
+    }
+
+    // fwd_us goes into the extension, never into a CRC trailer
+    uint16_t trailer = chunk_trailer_len(slot->dgram[6]);
+    if (fc->stamp_cycles_per_us && (slot->dgram[6] & CHUNK_FLAG_EXT) &&
+        slot->dgram_len >= CHUNK_HDR_LEN + trailer)
+        chunk_ext_set_fwd(slot->dgram + CHUNK_HDR_LEN,
+                          (uint16_t)(slot->dgram_len - CHUNK_HDR_LEN - trailer),
+                          (fwd_cycles(fc) - slot->rx_cycles) / fc->stamp_cycles_per_us);
+
+    if ((!fc->agg_max || !fwd_agg_add(fc, slot)) &&
+        fwd_send(fc, slot->dgram, slot->dgram_len) != 0)
+        fwd_tx_lost(fc, frame_id, 1);
+    uint32_t c1 = fwd_cycles(fc);
+
+    fc->stats.tx_chunks++;
+    fc->stats.fwd_cycles += slot->fwd_cycles;
+
+    bool fec_done = false;
+    if (fc->fec.m)
+    {
+        fec_done = fwd_fec_add(fc, slot);
+        fc->stats.fec_cycles += fwd_cycles(fc) - c1;
+    }
+    if (fc->retx_n)
+        fwd_retx_cache(fc, slot);
+
+    // The slot is only re-armed once its datagram has left, which is what
+    // holds RDY low under TX backlog on the ESP32
+    io->rx_arm(io->ctx, slot);
+
+    if (fec_done)
+        fwd_fec_send(fc);
+    fwd_poll(fc);
+}
+
+void fwd_retry_enable(fwd_core_t *fc, uint32_t deadline, unsigned backoff_us)
+{
+    // Without cycles() the deadline never passes and a send would retry forever
+    fc->retry_deadline = (fc->io->backoff && fc->io->cycles) ? deadline : 0;
+    fc->retry_backoff = backoff_us ? backoff_us : 1;
+}
+
+void fwd_latest_wins(fwd_core_t *fc, bool on)
+{
+    fc->latest_wins = on;
+}
+
+void fwd_stamp_enable(fwd_core_t *fc, unsigned cycles_per_us)
+{
+    fc->stamp_cycles_per_us = cycles_per_us;
+}
+
+void fwd_crc_check(fwd_core_t *fc, unsigned mode)
+{
+    fc->crc_mode = (uint8_t)(mode <= FWD_CRC_REQUIRE ? mode : FWD_CRC_REQUIRE);
+}
+
+void fwd_telemetry_fields(const fwd_stats_t *st, uint32_t *fields)
+{
+    fields[TELEM_RX_CHUNKS] = st->rx_chunks;
+    fields[TELEM_RX_BYTES] = st->rx_bytes;
+    fields[TELEM_RX_DROPPED] = st->rx_dropped;
+    fields[TELEM_SPI_WAIT_CYCLES] = st->spi_wait_cycles;
+    fields[TELEM_TX_CHUNKS] = st->tx_chunks;
+    fields[TELEM_TX_DGRAMS] = st->tx_dgrams;
+    fields[TELEM_TX_BYTES] = st->tx_bytes;
+    fields[TELEM_TX_ERRORS] = st->tx_errors;
+    fields[TELEM_TX_ENOMEM] = st->tx_enomem;
+    fields[TELEM_SEND_CYCLES] = st->send_cycles;
+    fields[TELEM_FWD_CYCLES] = st->fwd_cycles;
+    fields[TELEM_FEC_CHUNKS] = st->fec_chunks;
+    fields[TELEM_RETX_CHUNKS] = st->retx_chunks;
+    fields[TELEM_NACKS] = st->nacks;
+    fields[TELEM_AGG_DGRAMS] = st->agg_dgrams;
+    fields[TELEM_TX_RETRIES] = st->tx_retries;
+    fields[TELEM_TX_LOST] = st->tx_lost;
+    fields[TELEM_TX_SHED] = st->tx_shed;
+    fields[TELEM_FRAMES_SHED] = st->frames_shed;
+    fields[TELEM_TX_STALE] = st->tx_stale;
+    fields[TELEM_FRAMES_STALE] = st->frames_stale;
+    fields[TELEM_RX_CRC_BAD] = st->rx_crc_bad;
+    fields[TELEM_CRC_CYCLES] = st->crc_cycles;
+    fields[TELEM_RX_RESYNCS] = st->rx_resyncs;
+    fields[TELEM_RX_SKIPPED] = st->rx_skipped;
+}
@@ -0,0 +1,247 @@
+// main/fwd_core.h
+// SPI -> UDP forwarding core, free of ESP-IDF so it also builds on Linux
+// (see esp32c3/host). The platform supplies a fwd_transport_t; the core owns
+// slot layout, framing and per-chunk accounting.
+//
+// Threading: fwd_rx_next() and fwd_tx() may run in different tasks (the ESP32
+// does that with a queue in between). Each only writes its own stats fields,
+// and rx_arm() must be callable from both.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "chunk_proto.h"
+#include "fec.h"
+#include "telemetry.h"
+
+// Slot layout: [FWD_SLOT_HEADROOM | FWD_SLOT_RX_LEN]. SPI receives at
+// buf + FWD_SLOT_HEADROOM (kept 4-byte aligned for DMA). A single frame is
+// already [hdr|payload] there, behind the sync word if the sender uses one;
+// for a split payload the 10-byte header goes into the headroom in front of
+// it. Either way the datagram is contiguous. The receive is armed for
+// FWD_SLOT_RX_ALLOC bytes, a whole number of words, which the SPI slave DMA
+// needs to receive in place; framing only goes by the length received.
+#define FWD_SLOT_HEADROOM 12
+#define FWD_SLOT_RX_LEN (CHUNK_SYNC_LEN + CHUNK_HDR_LEN + CHUNK_PAYLOAD_MAX)
+#define FWD_SLOT_RX_ALLOC ((FWD_SLOT_RX_LEN + 3) & ~3)
+#define FWD_SLOT_LEN (FWD_SLOT_HEADROOM + FWD_SLOT_RX_ALLOC)
+
+// Parity chunks per frame the core can emit (fec.h allows up to FEC_MAX_PARITY);
+// each costs one FWD_FEC_DGRAM_LEN buffer inside fwd_core_t
+#ifndef FWD_FEC_MAX
+#define FWD_FEC_MAX 4
+#endif
+#define FWD_FEC_DGRAM_LEN (CHUNK_HDR_LEN + FEC_BLOCK_MAX)
+
+// NACK retransmission cache: a ring of [u16 dgram_len | datagram] entries, one
+// per sent data chunk. Chunks of a frame are cached at consecutive positions,
+// so (frame_id, chunk_id) maps to a position through a small table of recent
+// frames and a tag check, without searching.
+#define FWD_RETX_ENTRY_LEN (2 + CHUNK_HDR_LEN + CHUNK_PAYLOAD_MAX)
+#define FWD_RETX_FRAMES 8
+
+// Aggregation buffer: one MTU-safe UDP payload (1500 - IP - UDP headers)
+#define FWD_AGG_MAX 1472
+
+// Congested sends back off by doubling up to this
+#define FWD_BACKOFF_MAX_US 1000
+
+// fwd_crc_check() modes
+#define FWD_CRC_OFF 0     // forward chunks unchecked
+#define FWD_CRC_CHECK 1   // drop chunks whose CRC trailer does not match
+#define FWD_CRC_REQUIRE 2 // ... and chunks without one
+
+typedef struct fwd_slot
+{
+    uint8_t *buf;   // FWD_SLOT_LEN bytes (DMA-capable on target)
+    uint8_t *dgram; // start of [hdr + payload] inside buf
+    uint16_t dgram_len;
+    uint16_t rx_len;     // bytes received by the last transaction (set by rx_wait)
+    uint32_t fwd_cycles; // SPI completion -> datagram ready
+    uint32_t rx_cycles;  // cycles() at SPI completion (rx_wait() return)
+    void *priv;          // transport-private (spi_slave_transaction_t on ESP32)
+} fwd_slot_t;
+
+typedef struct fwd_transport
+{
+    void *ctx;
+    // Queue slot->buf + FWD_SLOT_HEADROOM as the next SPI receive
+    void (*rx_arm)(void *ctx, fwd_slot_t *slot);
+    // Block until the oldest armed slot completes; NULL stops the core
+    fwd_slot_t *(*rx_wait)(void *ctx);
+    // Send one datagram; 0 or -errno
+    int (*tx_send)(void *ctx, const uint8_t *buf, size_t len);
+    // Free-running counter for cost accounting (CPU cycles on target); may be NULL
+    uint32_t (*cycles)(void *ctx);
+    // Non-blocking receive of one datagram sent back to the UDP socket (NACKs);
+    // its length, or <= 0 when there is none. May be NULL.
+    int (*rx_ctrl)(void *ctx, uint8_t *buf, size_t cap);
+    // Wait about `us` microseconds before retrying a congested tx_send(); may
+    // be NULL (no retries)
+    void (*backoff)(void *ctx, uint32_t us);
+} fwd_transport_t;
+
+// Counters are plain uint32_t that wrap; each has one writer (the rx or the tx
+// side), so a reader on another task just copies the struct and works with
+// differences between copies. No locks, no atomics.
+typedef struct
+{
+    // rx side
+    uint32_t rx_chunks;
+    uint32_t rx_bytes;        // datagram bytes of those chunks
+    uint32_t rx_dropped;      // transactions that were neither header nor frame
+    uint32_t spi_wait_cycles; // time blocked in rx_wait()
+    uint32_t rx_crc_bad;      // chunks dropped by the CRC check (fwd_crc_check())
+    uint32_t crc_cycles;      // time spent checking CRCs
+    uint32_t rx_resyncs;      // transactions out of step with the framing
+    uint32_t rx_skipped;      // bytes thrown away getting back in step
+    // tx side
+    uint32_t tx_chunks;   // data chunks handled by fwd_tx()
+    uint32_t tx_dgrams;   // datagrams sent (data, aggregates, parity, resends)
+    uint32_t tx_bytes;    // bytes in those datagrams
+    uint32_t tx_errors;   // datagrams given up on (after retries)
+    uint32_t tx_enomem;   // congested tx_send() returns (lwIP pbufs / Wi-Fi TX queue)
+    uint32_t tx_retries;  // ... retried after a backoff
+    uint32_t tx_lost;     // data chunks in datagrams given up on
+    uint32_t tx_shed;     // ... not sent because their frame was already lost
+    uint32_t frames_shed; // frames cut short that way
+    uint32_t tx_stale;    // ... not sent because a newer frame was queued (latest wins)
+    uint32_t frames_stale; // frames skipped that way
+    uint32_t fwd_cycles;  // sum of slot->fwd_cycles over sent chunks
+    uint32_t send_cycles; // sum of time spent in tx_send()
+    uint32_t fec_chunks;  // parity chunks sent
+    uint32_t fec_skipped; // frames without parity (chunk lost before the tx side)
+    uint32_t fec_cycles;  // parity encode time, all chunks
+    uint32_t nacks;       // NACKs received
+    uint32_t retx_chunks; // chunks resent
+    uint32_t retx_miss;   // asked for, no longer (or never) in the cache
+    uint32_t retx_late;   // asked for after the deadline
+    uint32_t agg_dgrams;  // aggregated datagrams sent
+    uint32_t agg_chunks;  // chunks that went out inside them
+} fwd_stats_t;
+
+typedef struct
+{
+    uint32_t frame_id;
+    uint32_t pos;  // cache position of chunk 0
+    uint32_t sent; // cycles() when chunk 0 went out
+    bool valid;
+} fwd_retx_frame_t;
+
+typedef struct
+{
+    const fwd_transport_t *io;
+    bool expect_hdr;
+    uint8_t hdr[CHUNK_HDR_LEN]; // pending split header
+    fec_enc_t fec;              // tx side only
+    uint8_t fec_dgram[FWD_FEC_MAX][FWD_FEC_DGRAM_LEN];
+    // NACK retransmission, tx side only
+    uint8_t *retx_mem; // retx_n entries of FWD_RETX_ENTRY_LEN
+    uint16_t retx_n;   // 0 = off
+    uint32_t retx_pos; // next cache position to write
+    uint32_t retx_deadline;
+    unsigned retx_cur; // retx_frames[] entry of the frame being cached
+    fwd_retx_frame_t retx_frames[FWD_RETX_FRAMES];
+    // Aggregation, tx side only: [outer hdr | sub-hdr + payload ...]
+    uint16_t agg_max; // 0 = off
+    uint16_t agg_len; // 0 = nothing pending
+    uint8_t agg_count;
+    uint32_t agg_started;
+    uint32_t agg_deadline;
+    uint8_t agg[FWD_AGG_MAX];
+    // Congestion policy, tx side only
+    uint32_t retry_deadline; // cycles() to keep retrying one datagram, 0 = off
+    uint32_t retry_backoff;  // first backoff, us
+    uint32_t lost_frame;     // frame with data chunks given up on
+    unsigned lost_n;         // how many; beyond fec.m the frame is shed
+    // Latest frame wins: the rx side publishes the newest START it has seen,
+    // the tx side skips older frames that have not started going out
+    bool latest_wins;
+    volatile uint32_t rx_newest; // written by the rx side only
+    bool stale;                  // tx side: skipping stale_frame
+    uint32_t stale_frame;
+    uint32_t stamp_cycles_per_us; // fwd_us stamping (CHUNK_FLAG_EXT), 0 = off
+    uint8_t crc_mode;             // FWD_CRC_*, rx side only
+    fwd_stats_t stats;
+} fwd_core_t;
+
+// Arm all slots and reset state
+void fwd_init(fwd_core_t *fc, const fwd_transport_t *io, fwd_slot_t *slots, int n_slots);
+
+// Wait for the next chunk worth forwarding. Split headers and malformed
+// transactions are consumed (and their slots re-armed) internally.
+// Returns NULL once rx_wait() does.
+//
+// Framing errors cost the chunk they hit and no more: a split header whose
+// payload does not follow (the sender gave up on it, or it was cut short) is
+// dropped when the next transaction turns out to be something else, and a
+// transaction that is neither header, chunk nor the payload waited for is
+// searched for a sync word (chunk_proto.h CHUNK_SYNC_WORD) starting a header
+// or a chunk that runs to its end. Each such transaction counts in
+// rx_resyncs, the bytes given up in rx_skipped.
+fwd_slot_t *fwd_rx_next(fwd_core_t *fc);
+
+// Send the slot's datagram, then hand the slot back to SPI. With FEC on, the
+// chunk is also folded into the frame's parity, and the parity chunks follow
+// the END chunk. With aggregation on, the chunk may instead be copied into the
+// pending aggregate and go out later with its neighbours.
+void fwd_tx(fwd_core_t *fc, fwd_slot_t *slot);
+
+// Time-driven work: flush an aggregate past its deadline and answer NACKs.
+// fwd_tx() does this after every chunk; call it as well when there is nothing
+// to send.
+void fwd_poll(fwd_core_t *fc);
+
+// Emit `parity` parity chunks per frame (0 = off, clamped to FWD_FEC_MAX).
+// Call after fwd_init(), before the first fwd_tx().
+void fwd_fec_enable(fwd_core_t *fc, unsigned parity);
+
+// Cache the last n_entries sent data chunks in mem (n_entries *
+// FWD_RETX_ENTRY_LEN bytes) and resend them when a NACK arrives on
+// io->rx_ctrl, up to `deadline` cycles() after the frame's first chunk went
+// out; older requests are dropped so a retransmit never holds up newer frames.
+// Call after fwd_init(), before the first fwd_tx().
+void fwd_retx_enable(fwd_core_t *fc, uint8_t *mem, unsigned n_entries, uint32_t deadline);
+
+// Coalesce consecutive chunks of a frame into datagrams of up to max_bytes
+// (<= FWD_AGG_MAX, 0 = off; chunk_proto.h CHUNK_FLAG_AGG). An aggregate is sent
+// when the next chunk does not fit or belongs to another frame, at END, or
+// `deadline` cycles() after its first chunk. A nonzero deadline needs
+// io->cycles; without it aggregation stays off. Call after fwd_init().
+void fwd_agg_enable(fwd_core_t *fc, unsigned max_bytes, uint32_t deadline);
+
+// Retry a congested send (-ENOMEM, -ENOBUFS, -EAGAIN) after io->backoff()
+// waits of backoff_us, doubling up to FWD_BACKOFF_MAX_US, for up to `deadline`
+// cycles(); the slot, and with it RDY, stays held meanwhile. 0 = off; also off
+// unless io provides both backoff() and cycles(). Whether or not retries are
+// on, once more data chunks of a frame are given up on than FEC parity can
+// rebuild, the rest of the frame is shed instead of sent.
+// Call after fwd_init().
+void fwd_retry_enable(fwd_core_t *fc, uint32_t deadline, unsigned backoff_us);
+
+// Latest frame wins: a frame whose START reaches fwd_tx() when the rx side has
+// already received the START of a newer one is skipped whole, so the queue
+// never holds up the newest frame behind a complete older one. A frame that
+// has started going out is finished. Call after fwd_init().
+void fwd_latest_wins(fwd_core_t *fc, bool on);
+
+// Write fwd_us (SPI completion -> send, chunk_proto.h CHUNK_FLAG_EXT) into
+// chunks that carry the timestamp extension; cycles_per_us converts cycles(),
+// 0 = leave them alone. Aggregated chunks are stamped as they are copied in,
+// so their wait for the rest of the aggregate is not included. Call after
+// fwd_init().
+void fwd_stamp_enable(fwd_core_t *fc, unsigned cycles_per_us);
+
+// Check the CRC trailer (chunk_proto.h CHUNK_FLAG_CRC) of every chunk as it
+// comes off SPI and drop the ones that fail, before they are queued for
+// sending. FWD_CRC_REQUIRE also drops chunks without a trailer, which catches
+// a bit error in the flag itself, but only suits a sender that always adds
+// one. Call after fwd_init().
+void fwd_crc_check(fwd_core_t *fc, unsigned mode);
+
+// Fill the counter fields of a telemetry record (common/telemetry.h) from a
+// stats snapshot; the platform adds seq, uptime, clock, backlog and heap
+void fwd_telemetry_fields(const fwd_stats_t *st, uint32_t *fields);
@@ -4,11 +4,40 @@
 # Header format (little-endian, 10 bytes): <I H B B H
 #   frame_id(u32), chunk_id(u16), flags(u8), rsv(u8), payload_len(u16)
 #
-# Handshake:
+# Handshake (SINGLE_TXN = False, split framing):
 #   - Wait RDY=1 before sending header
 #   - CS low, spi.write(header), CS high
 #   - Wait RDY=1 before sending payload
 #   - CS low, spi.write(payload), CS high
+#
+# Handshake (SINGLE_TXN = True, single framing):
+#   - Wait RDY=1
+#   - CS low, spi.write(header), spi.write(payload), CS high
+#   The ESP32 sees one transaction and accepts both framings.
+#
+# Sync (SYNC = True): the header goes out behind a 4-byte sync word in both
+# framings (common/chunk_proto.h CHUNK_SYNC_WORD). If a transaction is lost or
+# cut short -- our own RDY timeout between header and payload, a CS glitch --
+# the ESP32 skips to the next sync word and loses just that chunk. While the
+# sync word goes out it clocks its link status back on MISO; a change in its
+# resync count is logged here.
+#
+# RDY is flow control: the ESP32 drops it at the end of every transaction and
+# raises it again only when a free receive buffer is armed, so waiting for
+# RDY=1 paces the sender to what Wi-Fi can actually carry.
+#
+# CRC (CRC = True): every chunk ends with a CRC-32 of header + payload
+# (common/chunk_proto.h CHUNK_FLAG_CRC). The ESP32 drops chunks garbled on SPI
+# before sending them, lvrecv checks again; worth it at higher SPI_BAUD.
+#
+# Pipeline (PIPELINE = True): a second thread sends frame N over SPI while the
+# main loop captures and encodes frame N+1. There is no fixed inter-frame
+# sleep; RDY backpressure (and MAX_FPS, if set) paces capture.
+#
+# Rate control (RATE_CTL = True, needs /flash/ratectl.py): each sent frame's
+# size, SPI send time and RDY wait time feed ratectl.RateCtl, which picks the
+# JPEG quality (and, with ADAPT_FRAMESIZE, the frame size) of the next capture
+# to hold TARGET_FPS within TARGET_BPS and what the link is measured to carry.
 
 import time
 import ustruct
@@ -25,25 +54,157 @@ PIN_CS = 25  # manual CS
 PIN_RDY = 21  # input from ESP32-C3 (RDY output)
 
 # ---- stream params ----
-JPEG_QUALITY = 50
+JPEG_QUALITY = 50  # fixed quality, or the starting point with RATE_CTL
 CHUNK_PAYLOAD = 1400  # <= ESP PAYLOAD_MAX (2048)
 SPI_BAUD = 10_000_000  # 先 10MHz，稳定后可提到 20MHz
+SINGLE_TXN = True  # header + payload in one CS frame: one RDY wait per chunk
+PIPELINE = True  # capture/encode frame N+1 while frame N is on SPI (needs _thread)
+MAX_FPS = 0  # 0 = as fast as RDY allows
+
+# ---- rate control ----
+RATE_CTL = True
+TARGET_FPS = 15
+TARGET_BPS = 150_000  # JPEG bytes/s ceiling, below the Wi-Fi link
+ADAPT_FRAMESIZE = False  # also step QVGA <-> QQVGA at the quality limits
+FRAMESIZES = (sensor.QVGA, sensor.QQVGA)
+
+# ---- latency stamps ----
+# Every chunk starts with the timestamp extension (common/chunk_proto.h): our
+# capture -> SPI age, plus a field the ESP32 fills with its forward delay.
+# lvrecv logs p50/p99 per stage. Costs EXT_LEN bytes of each chunk.
+TIMESTAMPS = True
+# Camera id carried in the extension (needs TIMESTAMPS); lvrecv names the
+# stream after it instead of the forwarder's address. 0 = unset.
+STREAM_ID = 0
+
+# ---- integrity ----
+# CRC-32 trailer on every chunk (ubinascii.crc32, in C); costs CRC_LEN bytes
+CRC = True
+# Sync word in front of every header (4 bytes per chunk); needs an ESP32 build
+# that knows it, older ones drop every chunk
+SYNC = True
 
 FLAG_START = 1
 FLAG_END = 2
+FLAG_CRC = 0x40
+FLAG_EXT = 0x80
 
 HDR_FMT = "<IHBBH"
 HDR_LEN = 10
+EXT_FMT = "<BBHII"  # ext_len, version, stream_id, capture_age_us, fwd_us
+EXT_LEN = 12
+CRC_LEN = 4
+SYNC_WORD = b"\xffLVS"
+LINK_STATUS_MAGIC = ord("S")
+
+
+# ---- RDY wait ----
+# A rising-edge IRQ on GPIOHS0 latches _rdy_edge, so the sender wakes within
+# RDY_SPIN_US of the ESP32 arming a buffer instead of up to 1 ms later.
+# _rdy_edge is cleared as each transaction starts; the edge that follows is the
+# ESP32 re-arming after *this* transaction, so a stale RDY=1 from before the
+# ESP32's end-of-transaction ISR can no longer be mistaken for a free buffer.
+# If the IRQ is unavailable, or a very short pulse is missed, a level read of
+# RDY=1 is accepted after RDY_EDGE_GRACE_US.
+# The wait polls: MaixPy's _thread lock ignores acquire()'s timeout and IRQ
+# callbacks run from the scheduler on the main thread, so there is nothing the
+# IRQ could release for the sender to block on. It spins only for the first
+# RDY_SPIN_MAX_US, where the ESP32 re-arming lands; a longer wait means its
+# queue is full (Wi-Fi backpressure), so waking up to 1 ms late costs no link
+# time and sleep_ms() leaves the CPU to capture and encode.
+RDY_TIMEOUT_US = 2_000_000
+RDY_SPIN_US = 10
+RDY_SPIN_MAX_US = 500
+RDY_EDGE_GRACE_US = 200
+
+_rdy_edge = False
+_rdy_irq = False
+rdy_wait_us = 0  # running total, sampled per frame for rate control
+
+
+def _on_rdy_rise(pin_num):
+    global _rdy_edge
+    _rdy_edge = True
+
+
+def rdy_txn_begin():
+    global _rdy_edge
+    _rdy_edge = False
+
+
+# log2 histogram of RDY wait times: bucket i counts waits < 2**i us
+RDY_HIST_BUCKETS = 22
+RDY_HIST_EVERY = 100  # frames between dumps; 0 = off
+rdy_hist = [0] * RDY_HIST_BUCKETS
 
 
-def wait_rdy(timeout_ms=2000):
-    t0 = time.ticks_ms()
+def rdy_hist_add(us):
+    i = 0
+    while i < RDY_HIST_BUCKETS - 1 and us >= (1 << i):
+        i += 1
+    rdy_hist[i] += 1
+
+
+def rdy_hist_dump():
+    n = sum(rdy_hist)
+    if not n:
+        return
+    parts = []
+    acc = 0
+    p50 = p99 = 0
+    for i, c in enumerate(rdy_hist):
+        acc += c
+        if c:
+            parts.append("<%d:%d" % (1 << i, c))
+        if not p50 and acc * 2 >= n:
+            p50 = 1 << i
+        if not p99 and acc * 100 >= n * 99:
+            p99 = 1 << i
+    print("[k210] rdy wait us n=%d p50<%d p99<%d %s" % (n, p50, p99, " ".join(parts)))
+    for i in range(RDY_HIST_BUCKETS):
+        rdy_hist[i] = 0
+
+
+def wait_rdy(timeout_us=RDY_TIMEOUT_US):
+    global rdy_wait_us
+    t0 = time.ticks_us()
     while True:
-        if rdy.value() == 1:
+        waited = time.ticks_diff(time.ticks_us(), t0)
+        if _rdy_edge or (
+            rdy.value() == 1 and (not _rdy_irq or waited >= RDY_EDGE_GRACE_US)
+        ):
+            rdy_hist_add(waited)
+            rdy_wait_us += waited
             return True
-        if time.ticks_diff(time.ticks_ms(), t0) > timeout_ms:
+        if waited > timeout_us:
+            rdy_wait_us += waited
             return False
-        time.sleep_ms(1)
+        if waited < RDY_SPIN_MAX_US:
+            time.sleep_us(RDY_SPIN_US)
+        else:
+            time.sleep_ms(1)
+
+
+# ---- link status, read back while the sync word goes out ----
+_status = bytearray(len(SYNC_WORD))
+_link_resyncs = None
+
+
+def send_sync():
+    spi.write_readinto(SYNC_WORD, _status)
+
+
+def link_check(frame_id, chunk_id):
+    global _link_resyncs
+    if _status[0] != LINK_STATUS_MAGIC:
+        return  # a forwarder without the status
+    n = _status[2] | _status[3] << 8
+    if _link_resyncs is not None and n != _link_resyncs:
+        print(
+            "[k210] ESP32 resynced SPI %d time(s) before frame=%d chunk=%d"
+            % ((n - _link_resyncs) & 0xFFFF, frame_id, chunk_id)
+        )
+    _link_resyncs = n
 
 
 # ---- copied/adapted from your MaixDuino WiFi code ----
@@ -97,6 +258,12 @@ cs.value(1)
 # RDY input
 fm.register(PIN_RDY, fm.fpioa.GPIOHS0)
 rdy = GPIO(GPIO.GPIOHS0, GPIO.IN)
+try:
+    rdy.irq(_on_rdy_rise, GPIO.IRQ_RISING, GPIO.WAKEUP_NOT_SUPPORT, 7)
+    _rdy_irq = True
+except Exception as e:
+    print("[k210] RDY irq unavailable (%s), polling" % e)
+_rdy_edge = rdy.value() == 1
 
 spi = SPI(
     SPI.SPI1,
@@ -114,62 +281,224 @@ sensor.set_pixformat(sensor.RGB565)
 sensor.set_framesize(sensor.QVGA)
 sensor.skip_frames(time=1200)
 
+ctl = None
+if RATE_CTL:
+    try:
+        from ratectl import RateCtl
+
+        ctl = RateCtl(
+            target_fps=TARGET_FPS,
+            target_bps=TARGET_BPS,
+            q_init=JPEG_QUALITY,
+            size_levels=len(FRAMESIZES) if ADAPT_FRAMESIZE else 1,
+        )
+    except Exception as e:
+        print("[k210] no ratectl (%s), fixed quality %d" % (e, JPEG_QUALITY))
+
+if CRC:
+    try:
+        from ubinascii import crc32
+    except ImportError:
+        print("[k210] no ubinascii.crc32, sending without CRC")
+        CRC = False
+
 print(
-    "[k210] ready: SPI1 baud=%d CHUNK=%d HDR_LEN=%d (manual CS)"
-    % (SPI_BAUD, CHUNK_PAYLOAD, HDR_LEN)
+    "[k210] ready: SPI1 baud=%d CHUNK=%d HDR_LEN=%d single=%d pipeline=%d crc=%d sync=%d"
+    " (manual CS)" % (SPI_BAUD, CHUNK_PAYLOAD, HDR_LEN, SINGLE_TXN, PIPELINE, CRC, SYNC)
 )
 
-frame_id = 0
+# ---- sender ----
+def crc_trailer(hdr, ext, payload):
+    # The ESP32 writes fwd_us (last 4 bytes of ext) later; it counts as 0, and
+    # ext_now() sends it as 0
+    c = crc32(hdr)
+    if ext:
+        c = crc32(ext, c)
+    return ustruct.pack("<I", crc32(payload, c) & 0xFFFFFFFF)
 
-while True:
-    img = sensor.snapshot()
 
-    # ✅ 关键：拿到真正 JPEG bytes（解决你现在 len(Image) 报错）
-    jpeg = jpeg_bytes_from_image(img, JPEG_QUALITY)
-    total = len(jpeg)
+def ext_now(t_cap):
+    if not TIMESTAMPS:
+        return b""
+    return ustruct.pack(EXT_FMT, EXT_LEN, 1, STREAM_ID, time.ticks_diff(time.ticks_us(), t_cap), 0)
 
+
+def send_frame(frame_id, jpeg, quality, t_cap):
+    total = len(jpeg)
     chunk_id = 0
     off = 0
+    t0 = time.ticks_us()
+    w0 = rdy_wait_us
+    data_max = CHUNK_PAYLOAD - (EXT_LEN if TIMESTAMPS else 0) - (CRC_LEN if CRC else 0)
 
     while off < total:
-        payload = jpeg[off : off + CHUNK_PAYLOAD]
+        payload = jpeg[off : off + data_max]
         payload_len = len(payload)
         off += payload_len
 
-        flags = 0
+        flags = FLAG_EXT if TIMESTAMPS else 0
+        if CRC:
+            flags |= FLAG_CRC
         if chunk_id == 0:
             flags |= FLAG_START
         if off >= total:
             flags |= FLAG_END
 
-        hdr = ustruct.pack(HDR_FMT, frame_id, chunk_id, flags, 0, payload_len)
+        ext_len = EXT_LEN if TIMESTAMPS else 0
+        crc_len = CRC_LEN if CRC else 0
+        hdr = ustruct.pack(HDR_FMT, frame_id, chunk_id, flags, 0, ext_len + payload_len + crc_len)
+
+        if SINGLE_TXN:
+            if not wait_rdy():
+                print(
+                    "[k210] RDY timeout frame=%d chunk=%d (rdy=%d)"
+                    % (frame_id, chunk_id, rdy.value())
+                )
+                break
+
+            ext = ext_now(t_cap)
+            tail = crc_trailer(hdr, ext, payload) if CRC else None
+            rdy_txn_begin()
+            cs.value(0)
+            if SYNC:
+                send_sync()
+            spi.write(hdr)
+            if ext:
+                spi.write(ext)
+            spi.write(payload)
+            if tail:
+                spi.write(tail)
+            cs.value(1)
+            if SYNC:
+                link_check(frame_id, chunk_id)
+
+            chunk_id += 1
+            continue
 
         # ---- send header ----
-        if not wait_rdy(2000):
+        if not wait_rdy():
             print(
                 "[k210] RDY timeout before HDR frame=%d chunk=%d (rdy=%d)"
                 % (frame_id, chunk_id, rdy.value())
             )
             break
 
+        rdy_txn_begin()
         cs.value(0)
+        if SYNC:
+            send_sync()
         spi.write(hdr)
         cs.value(1)
+        if SYNC:
+            link_check(frame_id, chunk_id)
 
         # ---- send payload ----
-        if not wait_rdy(2000):
+        if not wait_rdy():
             print(
                 "[k210] RDY timeout before PAYLOAD frame=%d chunk=%d (rdy=%d)"
                 % (frame_id, chunk_id, rdy.value())
             )
             break
 
+        ext = ext_now(t_cap)
+        tail = crc_trailer(hdr, ext, payload) if CRC else None
+        rdy_txn_begin()
         cs.value(0)
+        if ext:
+            spi.write(ext)
         spi.write(payload)
+        if tail:
+            spi.write(tail)
         cs.value(1)
 
         chunk_id += 1
 
-    print("[k210] sent frame=%d bytes=%d chunks=%d" % (frame_id, total, chunk_id))
+    send_us = time.ticks_diff(time.ticks_us(), t0)
+    if ctl is not None and off >= total:
+        ctl.update(total, send_us, rdy_wait_us - w0)
+
+    # q= keeps this line usable as a ratectl_sim.py trace
+    print(
+        "[k210] sent frame=%d bytes=%d chunks=%d q=%d send_us=%d"
+        % (frame_id, total, chunk_id, quality, send_us)
+    )
+    if RDY_HIST_EVERY and frame_id % RDY_HIST_EVERY == RDY_HIST_EVERY - 1:
+        rdy_hist_dump()
+
+
+_size_level = 0
+
+
+def capture():
+    global _size_level
+    quality = JPEG_QUALITY
+    if ctl is not None:
+        quality = ctl.q
+        if ctl.size_level != _size_level:
+            _size_level = ctl.size_level
+            sensor.set_framesize(FRAMESIZES[_size_level])
+            print("[k210] framesize level=%d" % _size_level)
+
+    img = sensor.snapshot()
+    t_cap = time.ticks_us()
+
+    # ✅ 关键：拿到真正 JPEG bytes（解决你现在 len(Image) 报错）
+    jpeg = jpeg_bytes_from_image(img, quality)
+
+    # the next snapshot reuses the frame buffer; keep our own copy while pipelined
+    if PIPELINE and not isinstance(jpeg, bytes):
+        jpeg = bytes(jpeg)
+    return jpeg, quality, t_cap
+
+
+# ---- pipeline: SPI sends frame N on a second thread while frame N+1 is
+# captured and encoded here. One frame waits in _next; when it is still full
+# the capture side waits too, so RDY backpressure paces the camera. ----
+_next = None
+
+
+def sender_thread():
+    global _next
+    while True:
+        item = _next
+        if item is None:
+            time.sleep_ms(1)
+            continue
+        _next = None
+        send_frame(*item)
+
+
+def frame_gap_ms():
+    return 1000 // MAX_FPS if MAX_FPS else 0
+
+
+if PIPELINE:
+    try:
+        import _thread
+
+        _thread.start_new_thread(sender_thread, ())
+    except Exception as e:
+        print("[k210] no _thread (%s), sending serially" % e)
+        PIPELINE = False
+
+frame_id = 0
+t_last = time.ticks_ms()
+
+while True:
+    jpeg, quality, t_cap = capture()
+
+    if PIPELINE:
+        while _next is not None:
+            time.sleep_ms(1)
+        _next = (frame_id, jpeg, quality, t_cap)
+    else:
+        send_frame(frame_id, jpeg, quality, t_cap)
     frame_id += 1
-    time.sleep_ms(30)
+
+    # optional frame-rate cap; otherwise RDY alone paces the loop
+    gap = frame_gap_ms()
+    if gap:
+        wait = gap - time.ticks_diff(time.ticks_ms(), t_last)
+        if wait > 0:
+            time.sleep_ms(wait)
+    t_last = time.ticks_ms()
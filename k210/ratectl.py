@@ -0,0 +1,134 @@
+# /flash/ratectl.py
+# Closed-loop JPEG rate controller for the K210 sender. Pure Python, no MaixPy
+# imports, so it runs unchanged on a Linux host (see ratectl_sim.py).
+#
+# Per frame the sender reports what it sent: JPEG bytes, total SPI send time
+# and how much of that was spent waiting for RDY. From that the controller
+#   - estimates link throughput (bytes/s over send time, EWMA),
+#   - sets a per-frame byte budget: min(target bitrate, link estimate * headroom)
+#     divided by the target fps. While RDY waits are a small share of the send
+#     time the link is not the bottleneck, so only the bitrate cap applies,
+#   - picks the quality whose predicted size fits the budget, using
+#     size ~= k * g(q) with k learned from the frames actually produced,
+#   - optionally steps the frame size down when even q_min is over budget and
+#     back up when q_max is comfortably under it.
+
+# IJG quality -> quantisation table scale (percent of the base tables)
+def _scale(q):
+    return 5000.0 / q if q < 50 else 200.0 - 2.0 * q
+
+
+# Relative JPEG size at quality q. Size falls off roughly as scale^-0.7 for
+# natural images; only the shape matters, k absorbs scene content.
+def size_model(q):
+    s = _scale(q)
+    if s < 1.0:
+        s = 1.0
+    return (100.0 / s) ** 0.7
+
+
+class RateCtl:
+    def __init__(
+        self,
+        target_fps=15,
+        target_bps=150000,
+        q_init=50,
+        q_min=10,
+        q_max=90,
+        max_step=8,
+        headroom=0.85,
+        alpha=0.3,
+        wait_frac_link=0.15,
+        size_levels=1,
+        size_level=0,
+        size_hold=10,
+    ):
+        self.target_fps = target_fps
+        self.target_bps = target_bps
+        self.q = q_init
+        self.q_min = q_min
+        self.q_max = q_max
+        self.max_step = max_step
+        self.headroom = headroom
+        self.alpha = alpha
+        # RDY wait share of send time above which the link is the bottleneck
+        self.wait_frac_link = wait_frac_link
+
+        # frame size: level 0 is the largest; size_levels=1 disables stepping.
+        # One level down is taken to quarter the pixel count (QVGA -> QQVGA).
+        self.size_levels = size_levels
+        self.size_level = size_level
+        self.size_hold = size_hold
+        self._over = 0
+        self._under = 0
+
+        self.link_bps = None  # EWMA of bytes/s while link-bound
+        self.k = None  # EWMA of bytes / size_model(q)
+        self.budget = target_bps / float(target_fps)
+
+    def _ewma(self, old, new):
+        return new if old is None else old + self.alpha * (new - old)
+
+    def update(self, nbytes, send_us, wait_us):
+        """Feed one sent frame; returns (quality, size_level) for the next."""
+        if nbytes <= 0:
+            return self.q, self.size_level
+
+        self.k = self._ewma(self.k, nbytes / size_model(self.q))
+
+        link_bound = send_us > 0 and wait_us > self.wait_frac_link * send_us
+        if send_us > 0 and link_bound:
+            self.link_bps = self._ewma(self.link_bps, nbytes * 1e6 / send_us)
+        elif self.link_bps is not None and send_us > 0:
+            # not link-bound: the link did at least this well, let it recover
+            self.link_bps = max(self.link_bps, nbytes * 1e6 / send_us)
+
+        bps = self.target_bps
+        if self.link_bps is not None and link_bound:
+            bps = min(bps, self.link_bps * self.headroom)
+        self.budget = bps / float(self.target_fps)
+
+        self.q = self._step_quality(self._quality_for(self.budget / self.k))
+        self._step_size(nbytes)
+        return self.q, self.size_level
+
+    def _quality_for(self, rel):
+        # smallest-error q with size_model(q) <= rel (size_model is increasing)
+        lo, hi = self.q_min, self.q_max
+        if size_model(lo) >= rel:
+            return lo
+        while lo < hi:
+            mid = (lo + hi + 1) // 2
+            if size_model(mid) <= rel:
+                lo = mid
+            else:
+                hi = mid - 1
+        return lo
+
+    def _step_quality(self, want):
+        if want > self.q + self.max_step:
+            want = self.q + self.max_step
+        elif want < self.q - self.max_step:
+            want = self.q - self.max_step
+        return max(self.q_min, min(self.q_max, want))
+
+    def _step_size(self, nbytes):
+        if self.size_levels <= 1:
+            return
+        if self.q == self.q_min and nbytes > self.budget:
+            self._over += 1
+            self._under = 0
+        elif self.q == self.q_max and nbytes * 4 < self.budget:
+            self._under += 1
+            self._over = 0
+        else:
+            self._over = self._under = 0
+
+        if self._over >= self.size_hold and self.size_level < self.size_levels - 1:
+            self.size_level += 1
+            self.k = self.k / 4.0 if self.k else None
+            self._over = 0
+        elif self._under >= self.size_hold and self.size_level > 0:
+            self.size_level -= 1
+            self.k = self.k * 4.0 if self.k else None
+            self._under = 0
@@ -0,0 +1,114 @@
+# k210/ratectl_sim.py
+# Host-side simulation of ratectl.RateCtl against a recorded frame-size trace.
+#
+#   python3 ratectl_sim.py TRACE [--link-bps N | --link "t0:bps,t1:bps,..."]
+#                          [--spi-bps N] [--fps N] [--target-bps N] [--csv OUT]
+#
+# TRACE is either the K210 console log ("[k210] sent frame=.. bytes=.. q=..")
+# or plain lines of "bytes" / "quality bytes". Each recorded frame stands for
+# the scene content at that moment: its size is rescaled to the controller's
+# quality with ratectl.size_model(). The sender is modelled like main.py:
+# SPI runs at spi-bps, and when the link is slower the difference is RDY wait.
+
+import argparse, re, sys
+
+from ratectl import RateCtl, size_model
+
+LOG_RE = re.compile(r"bytes=(\d+)(?:.*?\bq=(\d+))?")
+
+
+def load_trace(path, q_default):
+    frames = []
+    with open(path) as f:
+        for line in f:
+            m = LOG_RE.search(line)
+            if m:
+                frames.append((int(m.group(2) or q_default), int(m.group(1))))
+                continue
+            parts = line.split()
+            if len(parts) == 1 and parts[0].isdigit():
+                frames.append((q_default, int(parts[0])))
+            elif len(parts) == 2 and parts[0].isdigit() and parts[1].isdigit():
+                frames.append((int(parts[0]), int(parts[1])))
+    return frames
+
+
+def link_schedule(spec, default):
+    """'0:200000,10:80000' -> [(t, bps)], sorted by time in seconds."""
+    if not spec:
+        return [(0.0, float(default))]
+    out = []
+    for item in spec.split(","):
+        t, bps = item.split(":")
+        out.append((float(t), float(bps)))
+    return sorted(out)
+
+
+def link_at(sched, t):
+    bps = sched[0][1]
+    for t0, b in sched:
+        if t >= t0:
+            bps = b
+    return bps
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("trace")
+    ap.add_argument("--q-trace", type=int, default=50, help="quality of trace lines without q=")
+    ap.add_argument("--link-bps", type=float, default=150000)
+    ap.add_argument("--link", help="piecewise link rate 't:bps,...' (seconds)")
+    ap.add_argument("--spi-bps", type=float, default=1.25e6, help="SPI payload rate (10 MHz)")
+    ap.add_argument("--fps", type=float, default=15)
+    ap.add_argument("--target-bps", type=float, default=150000)
+    ap.add_argument("--loops", type=int, default=1, help="replay the trace N times")
+    ap.add_argument("--csv", help="write per-frame results")
+    args = ap.parse_args()
+
+    trace = load_trace(args.trace, args.q_trace)
+    if not trace:
+        sys.exit("no frames in %s" % args.trace)
+    sched = link_schedule(args.link, args.link_bps)
+
+    ctl = RateCtl(target_fps=args.fps, target_bps=args.target_bps)
+    out = open(args.csv, "w") if args.csv else None
+    if out:
+        out.write("t,frame,quality,bytes,budget,send_ms,wait_ms,link_bps\n")
+
+    t = 0.0
+    n = 0
+    total_bytes = 0
+    over = 0
+    qs = []
+    for _ in range(args.loops):
+        for q_rec, bytes_rec in trace:
+            q = ctl.q
+            nbytes = int(bytes_rec * size_model(q) / size_model(q_rec))
+            link = link_at(sched, t)
+            send_s = nbytes / min(link, args.spi_bps)
+            wait_s = max(0.0, send_s - nbytes / args.spi_bps)
+            budget = ctl.budget
+
+            ctl.update(nbytes, send_s * 1e6, wait_s * 1e6)
+            # pipelined sender: a frame slot is the longer of send and 1/fps
+            t += max(send_s, 1.0 / args.fps)
+            n += 1
+            total_bytes += nbytes
+            over += nbytes > budget * 1.2
+            qs.append(q)
+            if out:
+                out.write("%.3f,%d,%d,%d,%.0f,%.2f,%.2f,%.0f\n"
+                          % (t, n, q, nbytes, budget, send_s * 1e3, wait_s * 1e3, link))
+
+    if out:
+        out.close()
+    qs.sort()
+    print("[sim] frames=%d duration=%.1fs fps=%.1f (target %.1f)" % (n, t, n / t, args.fps))
+    print("[sim] avg bytes/frame=%.0f bitrate=%.0f B/s (target %.0f)"
+          % (total_bytes / float(n), total_bytes / t, args.target_bps))
+    print("[sim] quality p10=%d p50=%d p90=%d, frames >20%% over budget: %d"
+          % (qs[n // 10], qs[n // 2], qs[(n * 9) // 10], over))
+
+
+if __name__ == "__main__":
+    main()
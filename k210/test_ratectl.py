@@ -0,0 +1,106 @@
+# k210/test_ratectl.py
+# Host unit tests for ratectl.RateCtl, run by ctest (ratectl) or directly:
+#
+#   python3 test_ratectl.py
+#
+# The sender is modelled like ratectl_sim.py: a scene whose JPEG is
+# scene_bytes at q=50 and scales with ratectl.size_model(), SPI at spi_bps,
+# and RDY wait for the difference when the link is slower.
+
+import os, random, sys, unittest
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+sys.dont_write_bytecode = True  # ctest runs this from the source tree
+
+from ratectl import RateCtl, size_model
+
+SPI_BPS = 1000000.0
+
+
+def send(rc, scene_bytes, link_bps):
+    """One frame at the controller's quality; returns its size."""
+    nbytes = int(scene_bytes * size_model(rc.q))
+    spi_us = nbytes * 1e6 / SPI_BPS
+    send_us = nbytes * 1e6 / min(link_bps, SPI_BPS)
+    rc.update(nbytes, send_us, send_us - spi_us)
+    return nbytes
+
+
+class StepResponse(unittest.TestCase):
+    def test_settles_on_bitrate_target(self):
+        rc = RateCtl(target_fps=15, target_bps=150000, q_init=80)
+        for _ in range(40):
+            nbytes = send(rc, 20000, 10 * SPI_BPS)
+        # budget 10000 B/frame; q is an integer, so within one step of it
+        self.assertLessEqual(nbytes, 10000)
+        self.assertGreater(nbytes, 9000)
+        self.assertIsNone(rc.link_bps)
+
+    def test_follows_link_drop_and_recovery(self):
+        rc = RateCtl(target_fps=15, target_bps=150000, q_init=50)
+        for _ in range(30):
+            send(rc, 10000, 10 * SPI_BPS)
+        q_fast = rc.q
+
+        # Link falls to 60 kB/s: within 15 frames (1 s) every frame fits the
+        # link with the controller's headroom, and quality went down for it
+        sizes = [send(rc, 10000, 60000) for _ in range(30)]
+        for nbytes in sizes[15:]:
+            self.assertLessEqual(nbytes * 15, 60000 * rc.headroom)
+        self.assertLess(rc.q, q_fast)
+
+        # Link back: quality returns to where it was
+        for _ in range(30):
+            send(rc, 10000, 10 * SPI_BPS)
+        self.assertEqual(rc.q, q_fast)
+
+    def test_steps_no_more_than_max_step(self):
+        rc = RateCtl(q_init=50, max_step=8)
+        q = rc.q
+        for link in (10 * SPI_BPS, 20000, 10 * SPI_BPS, 20000):
+            for _ in range(10):
+                send(rc, 10000, link)
+                self.assertLessEqual(abs(rc.q - q), 8)
+                q = rc.q
+
+
+class Bounds(unittest.TestCase):
+    def test_quality_stays_in_bounds(self):
+        rnd = random.Random(1)
+        rc = RateCtl(q_min=10, q_max=90)
+        for _ in range(2000):
+            scene = rnd.choice((300, 3000, 30000, 300000))
+            link = rnd.choice((5000, 60000, 10 * SPI_BPS))
+            send(rc, scene, link)
+            self.assertGreaterEqual(rc.q, 10)
+            self.assertLessEqual(rc.q, 90)
+
+    def test_pins_at_bounds(self):
+        rc = RateCtl(q_min=10, q_max=90)
+        for _ in range(40):
+            send(rc, 200, 10 * SPI_BPS)
+        self.assertEqual(rc.q, 90)
+        for _ in range(40):
+            send(rc, 1000000, 10 * SPI_BPS)
+        self.assertEqual(rc.q, 10)
+
+    def test_ignores_empty_frames(self):
+        rc = RateCtl(q_init=50)
+        self.assertEqual(rc.update(0, 0, 0), (50, 0))
+        self.assertIsNone(rc.k)
+
+    def test_size_steps_down_then_back_up(self):
+        rc = RateCtl(q_min=10, q_max=90, size_levels=2, size_hold=10)
+        # Even q_min is over the budget at this link: one level down
+        for _ in range(40):
+            send(rc, 200000, 20000)
+        self.assertEqual(rc.size_level, 1)
+        # Quarter the pixels, quarter the scene; with a fast link and a small
+        # scene q_max sits far under budget: back up
+        for _ in range(60):
+            send(rc, 500 if rc.size_level else 2000, 10 * SPI_BPS)
+        self.assertEqual(rc.size_level, 0)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,307 @@
+// pc/receiver/bench.cpp
+// lvrecv_bench: K210-shaped chunk traffic over loopback into UdpRx +
+// StreamDemux, reporting assembled frames/s and assembly latency (END chunk
+// handed to the kernel -> frame complete in the assembler).
+//
+//   lvrecv_bench [--frames N] [--frame-bytes N] [--chunk-bytes N] [--fps N]
+//                [--streams N] [--senders N] [--workers N | --reuseport N] [--pin]
+//
+// --fps 0 (default) sends flat out; frames the kernel drops on the way show up
+// as "lost".
+//
+// Fleet load: --streams N simulates N cameras, each from its own source port
+// with --frames frames at --fps, spread over --senders threads. The receiver
+// shards them like lvrecv: --workers N over rings fed by one receive thread,
+// or --reuseport N over N SO_REUSEPORT sockets. Compare aggregate frames/s:
+//   lvrecv_bench --streams 256 --frames 200 --senders 4 --workers 4
+//   lvrecv_bench --streams 256 --frames 200 --senders 4 --reuseport 4 --pin
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <exception>
+#include <memory>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "chunk_proto.h"
+#include "frame_assembler.hpp"
+#include "stream_demux.hpp"
+#include "udp_rx.hpp"
+
+using bench_clock = std::chrono::steady_clock;
+
+static uint64_t now_ns()
+{
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        bench_clock::now().time_since_epoch())
+                        .count());
+}
+
+// END-chunk send time per stream and frame, read by the receiving threads
+static constexpr size_t kSentRing = 4096;
+static std::vector<std::atomic<uint64_t>> *g_end_sent_ns;
+
+static void usage(const char *argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s [--frames N] [--frame-bytes N] [--chunk-bytes N] [--fps N]\n"
+                 "          [--streams N] [--senders N] [--workers N | --reuseport N] [--pin]\n",
+                 argv0);
+}
+
+// Streams first, first + step, ... from their connected sockets, frames
+// interleaved across them
+static void send_frames(const std::vector<int> &fds, size_t first, size_t step, uint32_t frames,
+                        uint32_t frame_bytes, uint16_t chunk_bytes, double fps)
+{
+    std::vector<uint8_t> jpeg(frame_bytes);
+    for (size_t i = 0; i < jpeg.size(); i++)
+        jpeg[i] = uint8_t(i * 131 + 7);
+    uint8_t dgram[CHUNK_HDR_LEN + CHUNK_PAYLOAD_MAX];
+
+    auto period = std::chrono::duration<double>(fps > 0 ? 1.0 / fps : 0.0);
+    auto next = bench_clock::now();
+
+    for (uint32_t frame_id = 0; frame_id < frames; frame_id++)
+    {
+        for (size_t s = first; s < fds.size(); s += step)
+        {
+            uint32_t off = 0;
+            uint16_t chunk_id = 0;
+            while (off < frame_bytes)
+            {
+                chunk_hdr_t h = {};
+                h.frame_id = frame_id;
+                h.chunk_id = chunk_id;
+                h.payload_len = uint16_t(std::min<uint32_t>(chunk_bytes, frame_bytes - off));
+                if (chunk_id == 0)
+                    h.flags |= CHUNK_FLAG_START;
+                if (off + h.payload_len >= frame_bytes)
+                {
+                    h.flags |= CHUNK_FLAG_END;
+                    (*g_end_sent_ns)[s * kSentRing + frame_id % kSentRing].store(
+                        now_ns(), std::memory_order_release);
+                }
+                chunk_hdr_pack(dgram, &h);
+                std::copy_n(&jpeg[off], h.payload_len, dgram + CHUNK_HDR_LEN);
+                send(fds[s], dgram, CHUNK_HDR_LEN + h.payload_len, 0);
+
+                off += h.payload_len;
+                chunk_id++;
+            }
+        }
+
+        if (fps > 0)
+        {
+            next += std::chrono::duration_cast<bench_clock::duration>(period);
+            std::this_thread::sleep_until(next);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t frames = 20000;
+    uint32_t frame_bytes = 12000;
+    uint16_t chunk_bytes = 1400;
+    double fps = 0;
+    size_t streams = 1;
+    unsigned senders = 1;
+    bool reuse_port = false;
+    StreamDemux::Config dcfg;
+
+    static const option opts[] = {
+        {"frames", required_argument, nullptr, 'n'},
+        {"frame-bytes", required_argument, nullptr, 'f'},
+        {"chunk-bytes", required_argument, nullptr, 'c'},
+        {"fps", required_argument, nullptr, 'r'},
+        {"streams", required_argument, nullptr, 's'},
+        {"workers", required_argument, nullptr, 'w'},
+        {"senders", required_argument, nullptr, 'S'},
+        {"reuseport", required_argument, nullptr, 'u'},
+        {"pin", no_argument, nullptr, 'P'},
+        {nullptr, 0, nullptr, 0},
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:f:c:r:s:w:S:u:P", opts, nullptr)) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            frames = uint32_t(std::strtoul(optarg, nullptr, 0));
+            break;
+        case 'f':
+            frame_bytes = uint32_t(std::strtoul(optarg, nullptr, 0));
+            break;
+        case 'c':
+            chunk_bytes = uint16_t(std::strtoul(optarg, nullptr, 0));
+            break;
+        case 'r':
+            fps = std::atof(optarg);
+            break;
+        case 's':
+            streams = std::strtoul(optarg, nullptr, 0);
+            break;
+        case 'w':
+            dcfg.workers = unsigned(std::strtoul(optarg, nullptr, 0));
+            break;
+        case 'S':
+            senders = unsigned(std::strtoul(optarg, nullptr, 0));
+            break;
+        case 'u':
+            reuse_port = true;
+            dcfg.workers = unsigned(std::strtoul(optarg, nullptr, 0));
+            break;
+        case 'P':
+            dcfg.pin = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (chunk_bytes == 0 || chunk_bytes > CHUNK_PAYLOAD_MAX || frame_bytes == 0 || streams == 0 ||
+        senders == 0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    try
+    {
+        // Latencies per stream index, each filled by the stream's own worker
+        dcfg.max_streams = streams;
+        std::vector<std::atomic<uint64_t>> end_sent(streams * kSentRing);
+        g_end_sent_ns = &end_sent;
+        std::vector<int32_t> port_stream(65536, -1); // source port -> sender stream
+        std::vector<std::vector<double>> lat_us(streams);
+        std::atomic<uint64_t> done{0}, first_ns{0}, last_ns{0};
+        auto on_frame = [&](StreamDemux::Stream &st, const FrameView &frame, uint64_t) {
+            uint64_t t = now_ns();
+            size_t s = size_t(port_stream[ntohs(st.src.sin_port)]);
+            uint64_t sent = end_sent[s * kSentRing + frame.frame_id % kSentRing].load(
+                std::memory_order_acquire);
+            lat_us[st.index].push_back((t - sent) / 1e3);
+            uint64_t zero = 0;
+            first_ns.compare_exchange_strong(zero, t);
+            last_ns.store(t, std::memory_order_relaxed);
+            done.fetch_add(1, std::memory_order_relaxed);
+        };
+
+        std::unique_ptr<UdpRx> rx;
+        std::unique_ptr<StreamDemux> demux;
+        if (reuse_port)
+        {
+            demux = std::make_unique<StreamDemux>(dcfg, 0, on_frame);
+        }
+        else
+        {
+            rx = std::make_unique<UdpRx>(0, 16 << 20);
+            demux = std::make_unique<StreamDemux>(dcfg, *rx, on_frame);
+        }
+
+        std::vector<int> fds(streams);
+        for (size_t s = 0; s < streams; s++)
+        {
+            fds[s] = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+            if (fds[s] < 0)
+                throw std::system_error(errno, std::generic_category(), "socket");
+            sockaddr_in dst = {};
+            dst.sin_family = AF_INET;
+            dst.sin_port = htons(demux->port());
+            dst.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            connect(fds[s], reinterpret_cast<sockaddr *>(&dst), sizeof(dst));
+            socklen_t alen = sizeof(dst);
+            getsockname(fds[s], reinterpret_cast<sockaddr *>(&dst), &alen);
+            port_stream[ntohs(dst.sin_port)] = int32_t(s);
+        }
+
+        std::atomic<unsigned> sending{senders};
+        std::vector<std::thread> tx;
+        for (unsigned i = 0; i < senders; i++)
+        {
+            tx.emplace_back([&, i] {
+                send_frames(fds, i, senders, frames, frame_bytes, chunk_bytes, fps);
+                sending--;
+            });
+        }
+
+        // The rings need this thread to receive; SO_REUSEPORT workers do it themselves
+        uint64_t want = uint64_t(frames) * streams;
+        uint64_t seen = 0;
+        int idle = 0;
+        while (done.load(std::memory_order_relaxed) < want && idle < 3)
+        {
+            int n = 0;
+            if (rx)
+            {
+                n = rx->recv();
+                if (n)
+                    demux->push(*rx, n, now_ns());
+            }
+            else
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                n = int(done.load(std::memory_order_relaxed) != seen);
+                seen = done.load(std::memory_order_relaxed);
+            }
+            if (n == 0)
+                idle += sending ? 0 : 1;
+        }
+        for (auto &t : tx)
+            t.join();
+        demux->stop(); // join the workers before reading totals and lat_us
+        StreamDemux::Totals t = demux->totals();
+        demux.reset();
+        for (int fd : fds)
+            close(fd);
+
+        const auto &st = t.sum;
+        std::vector<double> lat;
+        for (const auto &v : lat_us)
+            lat.insert(lat.end(), v.begin(), v.end());
+        double dt = (last_ns - first_ns) / 1e9;
+        std::sort(lat.begin(), lat.end());
+        auto pct = [&](double p) {
+            return lat.empty() ? 0.0 : lat[size_t(p * double(lat.size() - 1))];
+        };
+
+        std::printf("[bench] %zu stream(s) x %u frames x %u B, %u B chunks, %s, %u sender(s), "
+                    "%u %s\n",
+                    streams, frames, frame_bytes, chunk_bytes, fps > 0 ? "paced" : "flat out",
+                    senders, dcfg.workers, reuse_port ? "SO_REUSEPORT workers" : "ring workers");
+        std::printf("[bench] assembled=%llu lost=%llu datagrams=%llu evicted=%llu qdrop=%llu\n",
+                    (unsigned long long)st.frames,
+                    (unsigned long long)(want - st.frames),
+                    (unsigned long long)st.datagrams,
+                    (unsigned long long)(st.overwritten + st.evicted_stale + st.evicted_aged),
+                    (unsigned long long)t.queue_drops);
+        std::printf("[bench] %.0f frames/s  %.1f MB/s  latency p50=%.1f us p99=%.1f us\n",
+                    dt > 0 ? (st.frames - 1) / dt : 0.0,
+                    dt > 0 ? (st.frames - 1) * double(frame_bytes) / dt / 1e6 : 0.0,
+                    pct(0.50), pct(0.99));
+        if (t.per_worker.size() > 1)
+        {
+            std::printf("[bench] streams per worker:");
+            for (size_t n : t.per_worker)
+                std::printf(" %zu", n);
+            std::printf("\n");
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "[bench] %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,177 @@
+// pc/receiver/capture_file.cpp
+
+#include "capture_file.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uint64_t clock_ns(clockid_t id)
+{
+    timespec ts;
+    clock_gettime(id, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ull + uint64_t(ts.tv_nsec);
+}
+
+CaptureWriter::CaptureWriter(const std::string &path, uint16_t port, size_t buffer_bytes)
+    : path_(path),
+      start_mono_ns_(clock_ns(CLOCK_MONOTONIC)),
+      buf_(std::max<size_t>(buffer_bytes, capture_rec_span(UINT16_MAX)))
+{
+    fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+        throw std::system_error(errno, std::generic_category(), path);
+
+    capture_hdr_t hdr = {};
+    std::memcpy(hdr.magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    hdr.version = CAPTURE_VERSION;
+    hdr.hdr_bytes = CAPTURE_HDR_BYTES;
+    hdr.start_wall_ns = clock_ns(CLOCK_REALTIME);
+    hdr.start_mono_ns = start_mono_ns_;
+    hdr.port = port;
+    std::memcpy(buf_.data(), &hdr, sizeof(hdr));
+    used_ = sizeof(hdr);
+    write_out();
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    flush();
+    close(fd_);
+}
+
+void CaptureWriter::add(const UdpRx &rx, int n, uint64_t now_ns)
+{
+    std::lock_guard<std::mutex> lock(mu_);
+    for (int i = 0; i < n; i++)
+        append(rx.data(i), rx.size(i), rx.src(i), now_ns);
+}
+
+void CaptureWriter::append(const uint8_t *d, size_t len, const sockaddr_in &src, uint64_t now_ns)
+{
+    len = std::min<size_t>(len, UINT16_MAX);
+    uint32_t span = capture_rec_span(uint16_t(len));
+    if (buf_.size() - used_ < span)
+        write_out();
+
+    capture_rec_t rec;
+    rec.t_ns = now_ns - start_mono_ns_;
+    rec.src_addr = src.sin_addr.s_addr;
+    rec.src_port = ntohs(src.sin_port);
+    rec.len = uint16_t(len);
+    uint8_t *p = &buf_[used_];
+    std::memcpy(p, &rec, sizeof(rec));
+    std::memcpy(p + CAPTURE_REC_BYTES, d, len);
+    std::memset(p + CAPTURE_REC_BYTES + len, 0, span - CAPTURE_REC_BYTES - len);
+    used_ += span;
+    records_++;
+}
+
+void CaptureWriter::flush()
+{
+    std::lock_guard<std::mutex> lock(mu_);
+    write_out();
+}
+
+// Caller holds mu_ (or is the constructor)
+void CaptureWriter::write_out()
+{
+    size_t off = 0;
+    while (off < used_)
+    {
+        ssize_t w = ::write(fd_, &buf_[off], used_ - off);
+        if (w < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            std::perror(path_.c_str()); // keep receiving; this batch is lost
+            break;
+        }
+        off += size_t(w);
+    }
+    bytes_ += off;
+    used_ = 0;
+}
+
+uint64_t CaptureWriter::records() const
+{
+    std::lock_guard<std::mutex> lock(mu_);
+    return records_;
+}
+
+uint64_t CaptureWriter::bytes() const
+{
+    std::lock_guard<std::mutex> lock(mu_);
+    return bytes_;
+}
+
+CaptureReader::CaptureReader(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), path);
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+    {
+        int err = errno;
+        close(fd);
+        throw std::system_error(err, std::generic_category(), "stat " + path);
+    }
+    len_ = size_t(st.st_size);
+    if (len_ < CAPTURE_HDR_BYTES)
+    {
+        close(fd);
+        throw std::runtime_error(path + ": not a capture file");
+    }
+    void *p = mmap(nullptr, len_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        throw std::system_error(errno, std::generic_category(), "mmap " + path);
+    map_ = static_cast<const uint8_t *>(p);
+    madvise(const_cast<uint8_t *>(map_), len_, MADV_SEQUENTIAL);
+
+    const capture_hdr_t &h = header();
+    if (std::memcmp(h.magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0 ||
+        h.version != CAPTURE_VERSION || h.hdr_bytes < CAPTURE_HDR_BYTES || h.hdr_bytes > len_)
+    {
+        munmap(const_cast<uint8_t *>(map_), len_);
+        map_ = nullptr;
+        throw std::runtime_error(path + ": not a capture file (or a newer version)");
+    }
+    rewind();
+}
+
+CaptureReader::~CaptureReader()
+{
+    if (map_)
+        munmap(const_cast<uint8_t *>(map_), len_);
+}
+
+bool CaptureReader::next(Record &r)
+{
+    if (len_ - off_ < CAPTURE_REC_BYTES)
+        return false;
+    capture_rec_t rec;
+    std::memcpy(&rec, map_ + off_, sizeof(rec));
+    uint32_t span = capture_rec_span(rec.len);
+    if (len_ - off_ < CAPTURE_REC_BYTES + size_t(rec.len))
+        return false; // torn
+    r.t_ns = rec.t_ns;
+    r.src = {};
+    r.src.sin_family = AF_INET;
+    r.src.sin_addr.s_addr = rec.src_addr;
+    r.src.sin_port = htons(rec.src_port);
+    r.data = map_ + off_ + CAPTURE_REC_BYTES;
+    r.len = rec.len;
+    off_ = std::min<size_t>(off_ + span, len_);
+    return true;
+}
@@ -0,0 +1,90 @@
+// pc/receiver/capture_file.hpp
+// Writer and reader for chunk-stream capture files (layout: common/capture.h).
+//
+// CaptureWriter appends whole receive batches to a buffer and write()s it out
+// in large pieces, so recording costs a memcpy per datagram on the receive
+// path; flush() bounds what a crash can lose. add() is thread-safe, so the
+// SO_REUSEPORT workers can share one file.
+//
+// CaptureReader maps the file read-only and walks the records in place.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <netinet/in.h>
+
+#include "capture.h"
+#include "udp_rx.hpp"
+
+class CaptureWriter
+{
+public:
+    // Create/truncate PATH and write the header. Throws std::system_error.
+    CaptureWriter(const std::string &path, uint16_t port, size_t buffer_bytes = 1 << 20);
+    ~CaptureWriter(); // flushes
+
+    CaptureWriter(const CaptureWriter &) = delete;
+    CaptureWriter &operator=(const CaptureWriter &) = delete;
+
+    // Record the n datagrams of rx's last batch, received at now_ns
+    // (CLOCK_MONOTONIC / steady_clock)
+    void add(const UdpRx &rx, int n, uint64_t now_ns);
+
+    // Write out what is buffered
+    void flush();
+
+    uint64_t records() const;
+    uint64_t bytes() const; // file size once flushed
+
+private:
+    void append(const uint8_t *d, size_t len, const sockaddr_in &src, uint64_t now_ns);
+    void write_out();
+
+    int fd_ = -1;
+    std::string path_;
+    uint64_t start_mono_ns_;
+    mutable std::mutex mu_;
+    std::vector<uint8_t> buf_;
+    size_t used_ = 0;
+    uint64_t records_ = 0;
+    uint64_t bytes_ = CAPTURE_HDR_BYTES;
+};
+
+class CaptureReader
+{
+public:
+    struct Record
+    {
+        uint64_t t_ns; // since the start of the recording
+        sockaddr_in src;
+        const uint8_t *data; // into the mapping
+        size_t len;
+    };
+
+    // Map PATH read-only. Throws std::system_error, or std::runtime_error if it
+    // is not a capture file.
+    explicit CaptureReader(const std::string &path);
+    ~CaptureReader();
+
+    CaptureReader(const CaptureReader &) = delete;
+    CaptureReader &operator=(const CaptureReader &) = delete;
+
+    const capture_hdr_t &header() const { return *reinterpret_cast<const capture_hdr_t *>(map_); }
+
+    // Next record; false at the end of the file (or at a torn last record)
+    bool next(Record &r);
+    void rewind() { off_ = header().hdr_bytes; }
+
+    // Bytes after the last whole record (a recorder that died mid-write)
+    size_t trailing() const { return off_ <= len_ ? len_ - off_ : 0; }
+
+private:
+    const uint8_t *map_ = nullptr;
+    size_t len_ = 0;
+    size_t off_ = 0;
+};
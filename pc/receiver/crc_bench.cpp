@@ -0,0 +1,307 @@
+// pc/receiver/crc_bench.cpp
+// crc_bench: the CRC-32 kernels of common/crc32.c and the chunk CRC trailer.
+// Checks the kernels against each other and the standard check value, checks
+// that a sealed chunk survives what the forwarder writes into it (RETX, fwd_us)
+// and fails on any other single bit flip, then times the kernels on --bytes
+// buffers. Last, --frames frames of CRC'd, stamped chunks with one FEC parity
+// chunk go through FrameAssembler with one bit flipped per frame: every
+// garbled chunk must be dropped and rebuilt from parity, byte for byte.
+//
+//   crc_bench [--bytes N] [--mib N] [--frames N]
+//
+// Exits 1 on any mismatch. The ESP32 logs the same kernel timings, plus the
+// ROM routine's, at boot (esp32c3/main/app_main.c CRC_CHECK).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <getopt.h>
+
+#include "chunk_proto.h"
+#include "crc32.h"
+#include "fec.h"
+#include "frame_assembler.hpp"
+
+using bench_clock = std::chrono::steady_clock;
+
+static uint64_t now_ns()
+{
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        bench_clock::now().time_since_epoch())
+                        .count());
+}
+
+static void usage(const char *argv0)
+{
+    std::fprintf(stderr, "usage: %s [--bytes N] [--mib N] [--frames N]\n", argv0);
+}
+
+typedef uint32_t (*crc_fn)(uint32_t, const void *, size_t);
+
+struct Kernel
+{
+    const char *name;
+    crc_fn fn;
+};
+
+static const Kernel kKernels[] = {
+    {"bytewise", crc32_ieee_bytewise},
+    {"slice-by-8", crc32_ieee_slice8},
+    {"crc32_ieee", crc32_ieee},
+};
+
+// Kernels agree with the check value and with each other, at any alignment,
+// length and split point
+static uint64_t check_kernels(std::mt19937 &rng)
+{
+    uint64_t bad = 0;
+    for (const Kernel &k : kKernels)
+    {
+        if (k.fn(0, "123456789", 9) != CRC32_CHECK_VALUE)
+        {
+            std::fprintf(stderr, "[crc_bench] %s: wrong check value\n", k.name);
+            bad++;
+        }
+    }
+
+    std::vector<uint8_t> buf(4096 + 8);
+    for (auto &b : buf)
+        b = uint8_t(rng());
+    for (int i = 0; i < 2000; i++)
+    {
+        size_t off = rng() % 8, len = rng() % 4097, cut = len ? rng() % len : 0;
+        const uint8_t *p = &buf[off];
+        uint32_t ref = crc32_ieee_bytewise(0, p, len);
+        for (const Kernel &k : kKernels)
+        {
+            if (k.fn(0, p, len) != ref || k.fn(k.fn(0, p, cut), p + cut, len - cut) != ref)
+            {
+                std::fprintf(stderr, "[crc_bench] %s: mismatch at offset %zu len %zu\n", k.name,
+                             off, len);
+                bad++;
+            }
+        }
+    }
+    return bad;
+}
+
+// [hdr | ext | data | crc], sealed the way the K210 does it
+static std::vector<uint8_t> make_chunk(uint32_t frame_id, uint16_t chunk_id, uint8_t flags,
+                                       const uint8_t *data, uint16_t len)
+{
+    chunk_hdr_t h = {};
+    h.frame_id = frame_id;
+    h.chunk_id = chunk_id;
+    h.flags = uint8_t(flags | CHUNK_FLAG_EXT | CHUNK_FLAG_CRC);
+    h.payload_len = uint16_t(CHUNK_EXT_LEN + len + CHUNK_CRC_LEN);
+    std::vector<uint8_t> d(CHUNK_HDR_LEN + h.payload_len);
+    chunk_hdr_pack(d.data(), &h);
+    chunk_ext_pack(d.data() + CHUNK_HDR_LEN, 7, 1234);
+    std::memcpy(d.data() + CHUNK_HDR_LEN + CHUNK_EXT_LEN, data, len);
+    chunk_crc_seal(d.data());
+    return d;
+}
+
+static bool chunk_ok(const std::vector<uint8_t> &d)
+{
+    chunk_hdr_t h;
+    chunk_hdr_parse(d.data(), &h);
+    return h.payload_len == d.size() - CHUNK_HDR_LEN && (h.flags & CHUNK_FLAG_CRC) &&
+           chunk_crc_ok(&h, d.data() + CHUNK_HDR_LEN);
+}
+
+// The trailer ignores exactly what the forwarder may change
+static uint64_t check_trailer(std::mt19937 &rng)
+{
+    std::vector<uint8_t> data(200);
+    for (auto &b : data)
+        b = uint8_t(rng());
+    const std::vector<uint8_t> sealed = make_chunk(42, 3, 0, data.data(), uint16_t(data.size()));
+    uint64_t bad = !chunk_ok(sealed);
+
+    std::vector<uint8_t> d = sealed;
+    d[6] |= CHUNK_FLAG_RETX;
+    chunk_ext_set_fwd(d.data() + CHUNK_HDR_LEN, uint16_t(d.size() - CHUNK_HDR_LEN - CHUNK_CRC_LEN),
+                      987654);
+    bad += !chunk_ok(d);
+
+    const size_t fwd_off = CHUNK_HDR_LEN + 8;
+    for (size_t bit = 0; bit < sealed.size() * 8; bit++)
+    {
+        size_t byte = bit / 8;
+        if ((byte == 6 && (1u << (bit % 8)) == CHUNK_FLAG_RETX) ||
+            (byte >= fwd_off && byte < fwd_off + 4))
+            continue;
+        d = sealed;
+        d[byte] ^= uint8_t(1u << (bit % 8));
+        if (chunk_ok(d))
+        {
+            std::fprintf(stderr, "[crc_bench] flip of bit %zu not detected\n", bit);
+            bad++;
+        }
+    }
+    return bad;
+}
+
+// One frame: data chunks as the K210 sends them, stamped by the "forwarder",
+// plus one parity chunk over the frame data
+static void make_frame(uint32_t frame_id, const std::vector<uint8_t> &jpeg, uint16_t data_bytes,
+                       fec_enc_t &enc, std::vector<std::vector<uint8_t>> &dgrams)
+{
+    dgrams.clear();
+    uint16_t chunk_id = 0;
+    for (size_t off = 0; off < jpeg.size(); chunk_id++)
+    {
+        uint16_t len = uint16_t(std::min<size_t>(data_bytes, jpeg.size() - off));
+        uint8_t flags = 0;
+        if (chunk_id == 0)
+            flags |= CHUNK_FLAG_START;
+        if (off + len >= jpeg.size())
+            flags |= CHUNK_FLAG_END;
+        std::vector<uint8_t> d = make_chunk(frame_id, chunk_id, flags, &jpeg[off], len);
+        chunk_ext_set_fwd(d.data() + CHUNK_HDR_LEN, uint16_t(d.size() - CHUNK_HDR_LEN - CHUNK_CRC_LEN),
+                          100 + chunk_id);
+        if (chunk_id == 0)
+            fec_enc_begin(&enc, frame_id);
+        fec_enc_add(&enc, frame_id, chunk_id, &jpeg[off], len);
+        dgrams.push_back(std::move(d));
+        off += len;
+    }
+
+    chunk_hdr_t h = {};
+    h.frame_id = frame_id;
+    h.chunk_id = uint16_t(enc.n);
+    h.rsv = chunk_rsv_parity(0, enc.m);
+    h.payload_len = enc.len;
+    std::vector<uint8_t> p(CHUNK_HDR_LEN + enc.len);
+    chunk_hdr_pack(p.data(), &h);
+    std::memcpy(p.data() + CHUNK_HDR_LEN, enc.parity[0], enc.len);
+    dgrams.push_back(std::move(p));
+}
+
+int main(int argc, char **argv)
+{
+    uint16_t bytes = 1400;
+    unsigned mib = 256;
+    uint32_t frames = 2000;
+
+    static const option opts[] = {
+        {"bytes", required_argument, nullptr, 'b'},
+        {"mib", required_argument, nullptr, 'M'},
+        {"frames", required_argument, nullptr, 'n'},
+        {nullptr, 0, nullptr, 0},
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "b:M:n:", opts, nullptr)) != -1)
+    {
+        switch (opt)
+        {
+        case 'b':
+            bytes = uint16_t(std::strtoul(optarg, nullptr, 0));
+            break;
+        case 'M':
+            mib = unsigned(std::strtoul(optarg, nullptr, 0));
+            break;
+        case 'n':
+            frames = uint32_t(std::strtoul(optarg, nullptr, 0));
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (bytes <= CHUNK_EXT_LEN + CHUNK_CRC_LEN || bytes > CHUNK_PAYLOAD_MAX || mib == 0)
+    {
+        std::fprintf(stderr, "need bytes %d..%d and mib > 0\n", CHUNK_EXT_LEN + CHUNK_CRC_LEN + 1,
+                     CHUNK_PAYLOAD_MAX);
+        return 2;
+    }
+
+    std::mt19937 rng(12345);
+    uint64_t bad = check_kernels(rng) + check_trailer(rng);
+
+    // Kernel throughput on chunk-sized buffers
+    std::vector<uint8_t> buf(bytes);
+    for (auto &b : buf)
+        b = uint8_t(rng());
+    uint64_t reps = (uint64_t(mib) << 20) / bytes;
+    std::printf("[crc_bench] %u B buffers, %u MiB per kernel\n", bytes, mib);
+    for (const Kernel &k : kKernels)
+    {
+        uint32_t acc = 0;
+        uint64_t t0 = now_ns();
+        for (uint64_t i = 0; i < reps; i++)
+            acc = k.fn(acc, buf.data(), buf.size());
+        uint64_t dt = std::max<uint64_t>(now_ns() - t0, 1);
+        std::printf("[crc_bench] %-11s %8.1f ns/buffer %7.0f MB/s  (%08x)\n", k.name,
+                    double(dt) / reps, double(reps) * bytes / (dt / 1e9) / 1e6, unsigned(acc));
+    }
+
+    std::vector<uint8_t> chunk = make_chunk(1, 1, 0, buf.data(),
+                                            uint16_t(bytes - CHUNK_EXT_LEN - CHUNK_CRC_LEN));
+    chunk_hdr_t ch;
+    chunk_hdr_parse(chunk.data(), &ch);
+    uint64_t ok = 0, t0 = now_ns();
+    for (uint64_t i = 0; i < reps; i++)
+        ok += chunk_crc_ok(&ch, chunk.data() + CHUNK_HDR_LEN);
+    uint64_t dt = std::max<uint64_t>(now_ns() - t0, 1);
+    std::printf("[crc_bench] chunk_crc_ok %7.1f ns/chunk\n", double(dt) / reps);
+    bad += ok != reps;
+
+    // Garbled chunks through the receiver: dropped, then rebuilt from parity
+    const uint32_t frame_bytes = 12000;
+    uint16_t data_bytes = uint16_t(bytes - CHUNK_EXT_LEN - CHUNK_CRC_LEN);
+    uint8_t par[FEC_BLOCK_MAX];
+    uint8_t *bufs[1] = {par};
+    fec_enc_t enc;
+    fec_enc_init(&enc, 1, bufs);
+    FrameAssembler fa;
+    std::vector<uint8_t> jpeg(frame_bytes);
+    std::vector<std::vector<uint8_t>> dgrams;
+    uint64_t rebuilt = 0;
+    t0 = now_ns();
+    for (uint32_t f = 0; f < frames; f++)
+    {
+        for (auto &b : jpeg)
+            b = uint8_t(rng());
+        make_frame(f, jpeg, data_bytes, enc, dgrams);
+
+        // One bit error in one data chunk, anywhere but the bits the CRC
+        // deliberately leaves out and the CRC flag itself (which only the
+        // forwarder's FWD_CRC_REQUIRE catches)
+        std::vector<uint8_t> &d = dgrams[rng() % (dgrams.size() - 1)];
+        size_t byte;
+        uint8_t mask;
+        do
+        {
+            byte = rng() % d.size();
+            mask = uint8_t(1u << (rng() % 8));
+        } while ((byte == 6 && (mask == CHUNK_FLAG_RETX || mask == CHUNK_FLAG_CRC)) ||
+                 (byte >= CHUNK_HDR_LEN + 8 && byte < CHUNK_HDR_LEN + 12));
+        d[byte] ^= mask;
+
+        FrameView out;
+        bool got = false;
+        for (const auto &g : dgrams)
+            got |= fa.push(g.data(), g.size(), now_ns(), out);
+        if (got && out.size == jpeg.size() && !std::memcmp(out.data, jpeg.data(), jpeg.size()))
+            rebuilt++;
+    }
+    dt = now_ns() - t0;
+    const auto &st = fa.stats();
+    std::printf("[crc_bench] %u frames with a bit error: crc_bad=%llu bad_datagrams=%llu "
+                "rebuilt=%llu (%.1f us/frame)\n",
+                frames, (unsigned long long)st.crc_bad, (unsigned long long)st.bad_datagrams,
+                (unsigned long long)rebuilt, frames ? dt / 1e3 / frames : 0.0);
+    // A flip in the flag byte or payload_len can make a chunk malformed rather
+    // than mismatched; either way it must not reach a frame
+    bad += rebuilt != frames || st.crc_bad + st.bad_datagrams + st.inconsistent < frames;
+
+    std::printf("[crc_bench] %s\n", bad ? "FAIL" : "ok");
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,231 @@
+// pc/receiver/fec_bench.cpp
+// fec_bench: cost of the FEC parity per frame. Encodes frames the way the
+// ESP32 forwarder does (fec_enc_add per chunk, parity at END), then feeds them
+// through FrameAssembler with no loss and with --loss random data chunks
+// dropped per frame, checking every rebuilt frame byte for byte.
+//
+//   fec_bench [--frames N] [--frame-bytes N] [--chunk-bytes N] [--parity M]
+//             [--loss E]
+//
+// Exits 1 if a frame is not rebuilt or comes back wrong (--loss <= --parity).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <getopt.h>
+
+#include "chunk_proto.h"
+#include "fec.h"
+#include "frame_assembler.hpp"
+
+using bench_clock = std::chrono::steady_clock;
+
+static uint64_t now_ns()
+{
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        bench_clock::now().time_since_epoch())
+                        .count());
+}
+
+static void usage(const char *argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s [--frames N] [--frame-bytes N] [--chunk-bytes N] [--parity M]\n"
+                 "          [--loss E]\n",
+                 argv0);
+}
+
+struct Encoded
+{
+    std::vector<std::vector<uint8_t>> data;   // datagrams
+    std::vector<std::vector<uint8_t>> parity; // datagrams
+};
+
+// Chunk and encode one frame; returns the encode time in ns
+static uint64_t encode(uint32_t frame_id, const std::vector<uint8_t> &jpeg, uint16_t chunk_bytes,
+                       fec_enc_t &enc, Encoded &e)
+{
+    e.data.clear();
+    e.parity.clear();
+
+    uint64_t cost = 0;
+    uint32_t off = 0;
+    uint16_t chunk_id = 0;
+    while (off < jpeg.size())
+    {
+        chunk_hdr_t h = {};
+        h.frame_id = frame_id;
+        h.chunk_id = chunk_id;
+        h.payload_len = uint16_t(std::min<size_t>(chunk_bytes, jpeg.size() - off));
+        if (chunk_id == 0)
+            h.flags |= CHUNK_FLAG_START;
+        if (off + h.payload_len >= jpeg.size())
+            h.flags |= CHUNK_FLAG_END;
+
+        std::vector<uint8_t> d(CHUNK_HDR_LEN + h.payload_len);
+        chunk_hdr_pack(d.data(), &h);
+        std::memcpy(d.data() + CHUNK_HDR_LEN, &jpeg[off], h.payload_len);
+
+        uint64_t t0 = now_ns();
+        if (chunk_id == 0)
+            fec_enc_begin(&enc, frame_id);
+        fec_enc_add(&enc, frame_id, chunk_id, d.data() + CHUNK_HDR_LEN, h.payload_len);
+        cost += now_ns() - t0;
+
+        e.data.push_back(std::move(d));
+        off += h.payload_len;
+        chunk_id++;
+    }
+
+    for (unsigned j = 0; enc.active && j < enc.m; j++)
+    {
+        chunk_hdr_t h = {};
+        h.frame_id = frame_id;
+        h.chunk_id = uint16_t(enc.n + j);
+        h.rsv = chunk_rsv_parity(j, enc.m);
+        h.payload_len = enc.len;
+        std::vector<uint8_t> p(CHUNK_HDR_LEN + enc.len);
+        chunk_hdr_pack(p.data(), &h);
+        std::memcpy(p.data() + CHUNK_HDR_LEN, enc.parity[j], enc.len);
+        e.parity.push_back(std::move(p));
+    }
+    return cost;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t frames = 20000;
+    uint32_t frame_bytes = 12000;
+    uint16_t chunk_bytes = 1400;
+    unsigned parity = 2;
+    unsigned loss = 0;
+    bool loss_set = false;
+
+    static const option opts[] = {
+        {"frames", required_argument, nullptr, 'n'},
+        {"frame-bytes", required_argument, nullptr, 'f'},
+        {"chunk-bytes", required_argument, nullptr, 'c'},
+        {"parity", required_argument, nullptr, 'm'},
+        {"loss", required_argument, nullptr, 'l'},
+        {nullptr, 0, nullptr, 0},
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:f:c:m:l:", opts, nullptr)) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            frames = uint32_t(std::strtoul(optarg, nullptr, 0));
+            break;
+        case 'f':
+            frame_bytes = uint32_t(std::strtoul(optarg, nullptr, 0));
+            break;
+        case 'c':
+            chunk_bytes = uint16_t(std::strtoul(optarg, nullptr, 0));
+            break;
+        case 'm':
+            parity = unsigned(std::strtoul(optarg, nullptr, 0));
+            break;
+        case 'l':
+            loss = unsigned(std::strtoul(optarg, nullptr, 0));
+            loss_set = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!loss_set)
+        loss = parity;
+    uint32_t n_data = (frame_bytes + chunk_bytes - 1) / std::max<uint32_t>(chunk_bytes, 1);
+    if (chunk_bytes == 0 || chunk_bytes > CHUNK_PAYLOAD_MAX || frame_bytes == 0 ||
+        parity < 1 || parity > FEC_MAX_PARITY || n_data + parity > FEC_MAX_CHUNKS ||
+        loss > n_data)
+    {
+        std::fprintf(stderr, "need chunk-bytes 1..%d, parity 1..%d, chunks + parity <= %d, "
+                             "loss <= chunks\n",
+                     CHUNK_PAYLOAD_MAX, FEC_MAX_PARITY, FEC_MAX_CHUNKS);
+        return 2;
+    }
+
+    std::vector<uint8_t> bufs_mem(parity * FEC_BLOCK_MAX);
+    uint8_t *bufs[FEC_MAX_PARITY];
+    for (unsigned j = 0; j < parity; j++)
+        bufs[j] = &bufs_mem[j * FEC_BLOCK_MAX];
+    fec_enc_t enc;
+    fec_enc_init(&enc, parity, bufs);
+
+    FrameAssembler::Config cfg;
+    cfg.max_frame_bytes = std::max<size_t>(frame_bytes, cfg.max_frame_bytes);
+    FrameAssembler clean(cfg), lossy(cfg);
+
+    std::mt19937 rng(12345);
+    std::vector<uint8_t> jpeg(frame_bytes);
+    std::vector<unsigned> order(n_data);
+    Encoded e;
+    uint64_t enc_ns = 0, clean_ns = 0, lossy_ns = 0;
+    uint64_t bad = 0;
+
+    for (uint32_t f = 0; f < frames; f++)
+    {
+        for (size_t i = 0; i < jpeg.size(); i++)
+            jpeg[i] = uint8_t(rng());
+        enc_ns += encode(f, jpeg, chunk_bytes, enc, e);
+
+        FrameView out;
+        bool got = false;
+        uint64_t t0 = now_ns();
+        for (const auto &d : e.data)
+            got |= clean.push(d.data(), d.size(), t0, out);
+        for (const auto &p : e.parity)
+            clean.push(p.data(), p.size(), t0, out);
+        clean_ns += now_ns() - t0;
+        if (!got)
+            bad++;
+
+        // Drop `loss` distinct data chunks
+        for (unsigned i = 0; i < n_data; i++)
+            order[i] = i;
+        std::shuffle(order.begin(), order.end(), rng);
+        std::vector<bool> drop(n_data, false);
+        for (unsigned i = 0; i < loss; i++)
+            drop[order[i]] = true;
+
+        got = false;
+        t0 = now_ns();
+        for (unsigned i = 0; i < n_data; i++)
+        {
+            if (!drop[i])
+                got |= lossy.push(e.data[i].data(), e.data[i].size(), t0, out);
+        }
+        for (const auto &p : e.parity)
+        {
+            if (!got)
+                got = lossy.push(p.data(), p.size(), t0, out);
+        }
+        lossy_ns += now_ns() - t0;
+        if (loss <= parity &&
+            (!got || out.size != jpeg.size() || std::memcmp(out.data, jpeg.data(), jpeg.size())))
+            bad++;
+    }
+
+    const auto &ls = lossy.stats();
+    double mb = double(frame_bytes) * frames / 1e6;
+    std::printf("[fec_bench] %u frames x %u B, %u data + %u parity chunks, loss %u/frame (%s)\n",
+                frames, frame_bytes, n_data, parity, loss, fec_impl());
+    std::printf("[fec_bench] encode            %8.1f us/frame  %7.0f MB/s\n",
+                enc_ns / 1e3 / frames, mb / (enc_ns / 1e9));
+    std::printf("[fec_bench] assemble, clean   %8.1f us/frame  %7.0f MB/s\n",
+                clean_ns / 1e3 / frames, mb / (clean_ns / 1e9));
+    std::printf("[fec_bench] assemble+recover  %8.1f us/frame  %7.0f MB/s\n",
+                lossy_ns / 1e3 / frames, mb / (lossy_ns / 1e9));
+    std::printf("[fec_bench] recovered=%llu chunks in %llu frames, failed=%llu, bad=%llu\n",
+                (unsigned long long)ls.fec_recovered, (unsigned long long)ls.fec_frames,
+                (unsigned long long)ls.fec_failed, (unsigned long long)bad);
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,535 @@
+// pc/receiver/frame_assembler.cpp
+
+#include "frame_assembler.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "chunk_proto.h"
+#include "crc32.h"
+#include "fec.h"
+
+// frame_id comparison with wrap-around (serial number arithmetic)
+static inline bool seq_before(uint32_t a, uint32_t b)
+{
+    return int32_t(a - b) < 0;
+}
+
+// Parity chunks never carry a CRC trailer, so a CRC'd chunk that claims to be
+// parity is a garbled data chunk, and goes where its CRC gets checked
+static inline bool is_parity_chunk(const chunk_hdr_t &h)
+{
+    return (h.rsv & CHUNK_RSV_PARITY) && !(h.flags & CHUNK_FLAG_CRC);
+}
+
+FrameAssembler::FrameAssembler(const Config &cfg)
+    : cfg_(cfg),
+      bitmap_words_((cfg.max_chunks + 63) / 64),
+      slab_(cfg.slots * cfg.max_frame_bytes),
+      parked_(cfg.slots * CHUNK_PAYLOAD_MAX),
+      bitmaps_(cfg.slots * bitmap_words_),
+      parity_(cfg.slots * FEC_MAX_PARITY * FEC_BLOCK_MAX),
+      fec_out_(FEC_MAX_PARITY * FEC_BLOCK_MAX),
+      slots_(cfg.slots)
+{
+    for (size_t i = 0; i < slots_.size(); i++)
+    {
+        slots_[i].data = &slab_[i * cfg_.max_frame_bytes];
+        slots_[i].parked = &parked_[i * CHUNK_PAYLOAD_MAX];
+        slots_[i].bits = &bitmaps_[i * bitmap_words_];
+        slots_[i].parity = &parity_[i * FEC_MAX_PARITY * FEC_BLOCK_MAX];
+    }
+}
+
+void FrameAssembler::expire(uint64_t now_ns)
+{
+    for (Slot &slot : slots_)
+    {
+        if (slot.active && now_ns - slot.started_ns > cfg_.max_age_ns)
+        {
+            slot.active = false;
+            stats_.evicted_aged++;
+        }
+    }
+}
+
+void FrameAssembler::evict_older_than(uint32_t frame_id)
+{
+    for (Slot &slot : slots_)
+    {
+        if (slot.active && seq_before(slot.frame_id, frame_id))
+        {
+            slot.active = false;
+            stats_.evicted_stale++;
+        }
+    }
+}
+
+void FrameAssembler::open(Slot &slot, uint32_t frame_id, uint64_t now_ns)
+{
+    slot.frame_id = frame_id;
+    slot.active = true;
+    slot.stride = 0;
+    slot.received = 0;
+    slot.end_chunk = kNoEnd;
+    slot.end_len = 0;
+    slot.end_parked = false;
+    slot.started_ns = now_ns;
+    slot.n_data = -1;
+    slot.parity_have = 0;
+    slot.parity_len = 0;
+    slot.last_ns = now_ns;
+    slot.max_chunk = -1;
+    slot.nacks = 0;
+    slot.stamped = false;
+    slot.capture_us = 0;
+    slot.fwd_us = 0;
+    std::memset(slot.bits, 0, bitmap_words_ * sizeof(uint64_t));
+}
+
+// Copy one chunk into place. Returns false if the frame must be dropped.
+bool FrameAssembler::place(Slot &slot, uint16_t chunk_id, const uint8_t *payload, uint16_t len)
+{
+    bool is_end = int32_t(chunk_id) == slot.end_chunk;
+
+    if (!is_end)
+    {
+        if (slot.stride == 0)
+        {
+            slot.stride = len;
+            if (slot.end_parked)
+            {
+                // Now the END chunk's offset is known
+                size_t end_off = size_t(slot.end_chunk) * slot.stride;
+                if (end_off + slot.end_len > cfg_.max_frame_bytes)
+                {
+                    stats_.oversize_chunks++;
+                    return false;
+                }
+                std::memcpy(slot.data + end_off, slot.parked, slot.end_len);
+                slot.end_parked = false;
+            }
+        }
+        else if (len != slot.stride)
+        {
+            stats_.inconsistent++;
+            return false;
+        }
+    }
+    else if (slot.stride == 0 && chunk_id != 0)
+    {
+        std::memcpy(slot.parked, payload, len);
+        slot.end_parked = true;
+        return true;
+    }
+
+    size_t off = size_t(chunk_id) * slot.stride;
+    if (off + len > cfg_.max_frame_bytes)
+    {
+        stats_.oversize_chunks++;
+        return false;
+    }
+    std::memcpy(slot.data + off, payload, len);
+    return true;
+}
+
+// Store one parity chunk. Returns false if the frame must be dropped.
+bool FrameAssembler::push_parity(Slot &slot, const chunk_hdr_t &h, const uint8_t *payload)
+{
+    unsigned j = chunk_parity_index(h.rsv);
+    unsigned m = chunk_parity_count(h.rsv);
+    int32_t n = int32_t(h.chunk_id) - int32_t(j);
+
+    if (j >= m || n < 1 || size_t(n) > cfg_.max_chunks || unsigned(n) + m > FEC_MAX_CHUNKS ||
+        h.payload_len <= FEC_LEN_PREFIX)
+    {
+        stats_.bad_datagrams++;
+        return true;
+    }
+    if ((slot.n_data >= 0 && slot.n_data != n) ||
+        (slot.end_chunk != kNoEnd && slot.end_chunk + 1 != n) ||
+        (slot.parity_have && slot.parity_len != h.payload_len))
+    {
+        stats_.inconsistent++;
+        return false;
+    }
+    if (slot.parity_have & (1u << j))
+    {
+        stats_.duplicates++;
+        return true;
+    }
+
+    std::memcpy(slot.parity + j * FEC_BLOCK_MAX, payload, h.payload_len);
+    slot.n_data = n;
+    slot.parity_len = h.payload_len;
+    slot.parity_have |= uint8_t(1u << j);
+    stats_.parity_chunks++;
+    return true;
+}
+
+// Rebuild missing data chunks once there is enough parity. Returns false if
+// the frame must be dropped.
+bool FrameAssembler::recover(Slot &slot)
+{
+    if (!slot.parity_have || slot.n_data < 0)
+        return true;
+    unsigned n = unsigned(slot.n_data);
+    unsigned ne = n - slot.received;
+    if (ne == 0 || ne > unsigned(__builtin_popcount(slot.parity_have)))
+        return true;
+
+    uint8_t rows[FEC_MAX_PARITY];
+    uint16_t cols[FEC_MAX_PARITY];
+    uint8_t *syn[FEC_MAX_PARITY];
+    uint8_t *out[FEC_MAX_PARITY];
+
+    for (unsigned j = 0, r = 0; r < ne; j++)
+    {
+        if (slot.parity_have & (1u << j))
+        {
+            rows[r] = uint8_t(j);
+            syn[r] = slot.parity + j * FEC_BLOCK_MAX;
+            out[r] = &fec_out_[r * FEC_BLOCK_MAX];
+            r++;
+        }
+    }
+
+    // Fold the data we have out of the parity, leaving only the missing blocks
+    unsigned k = 0;
+    for (unsigned i = 0; i < n; i++)
+    {
+        if (!(slot.bits[i / 64] & (uint64_t(1) << (i % 64))))
+        {
+            cols[k++] = uint16_t(i);
+            continue;
+        }
+        bool is_end = int32_t(i) == slot.end_chunk;
+        const uint8_t *payload = (is_end && slot.end_parked) ? slot.parked
+                                                              : slot.data + size_t(i) * slot.stride;
+        uint16_t len = is_end ? slot.end_len : slot.stride;
+        if (FEC_LEN_PREFIX + len > slot.parity_len)
+        {
+            stats_.inconsistent++;
+            return false;
+        }
+        for (unsigned r = 0; r < ne; r++)
+            fec_block_add(syn[r], rows[r], i, payload, len);
+    }
+
+    if (fec_solve(ne, rows, cols, syn, slot.parity_len, out) != 0)
+    {
+        stats_.fec_failed++;
+        return false;
+    }
+
+    for (k = 0; k < ne; k++)
+    {
+        uint16_t len = chunk_rd16(out[k]);
+        if (len > CHUNK_PAYLOAD_MAX || FEC_LEN_PREFIX + len > slot.parity_len)
+        {
+            stats_.fec_failed++;
+            return false;
+        }
+        if (cols[k] == n - 1)
+        {
+            slot.end_chunk = int32_t(cols[k]);
+            slot.end_len = len;
+        }
+        if (!place(slot, cols[k], out[k] + FEC_LEN_PREFIX, len))
+        {
+            stats_.fec_failed++;
+            return false;
+        }
+        slot.bits[cols[k] / 64] |= uint64_t(1) << (cols[k] % 64);
+        slot.received++;
+    }
+    stats_.fec_recovered += ne;
+    stats_.fec_frames++;
+    return true;
+}
+
+// Emit the slot's frame if every chunk 0..END is in
+bool FrameAssembler::finish(Slot &slot, uint64_t now_ns, FrameView &out)
+{
+    if (slot.end_chunk == kNoEnd || slot.received != slot.end_chunk + 1 || slot.end_parked)
+        return false;
+
+    slot.active = false;
+    stats_.frames++;
+    have_done_ = true;
+    last_done_ = slot.frame_id;
+    evict_older_than(slot.frame_id);
+    expire(now_ns);
+
+    out.frame_id = slot.frame_id;
+    out.data = slot.data;
+    out.size = size_t(slot.end_chunk) * slot.stride + slot.end_len;
+    out.stamped = slot.stamped;
+    out.capture_us = slot.capture_us;
+    out.fwd_us = slot.fwd_us;
+    out.assemble_ns = now_ns - slot.started_ns;
+    return true;
+}
+
+bool FrameAssembler::push(const uint8_t *dgram, size_t len, uint64_t now_ns, FrameView &out)
+{
+    stats_.datagrams++;
+
+    chunk_hdr_t h;
+    if (len < CHUNK_HDR_LEN)
+    {
+        stats_.bad_datagrams++;
+        return false;
+    }
+    chunk_hdr_parse(dgram, &h);
+    if (h.flags & CHUNK_FLAG_AGG)
+        return push_agg(h, dgram + CHUNK_HDR_LEN, len - CHUNK_HDR_LEN, now_ns, out);
+
+    bool is_parity = is_parity_chunk(h);
+    size_t max_payload = is_parity ? FEC_BLOCK_MAX : CHUNK_PAYLOAD_MAX;
+    if (h.payload_len > len - CHUNK_HDR_LEN || h.payload_len > max_payload)
+    {
+        stats_.bad_datagrams++;
+        return false;
+    }
+    return push_chunk(h, dgram + CHUNK_HDR_LEN, now_ns, out);
+}
+
+// Unpack an aggregated datagram: every sub-chunk goes through push_chunk() as
+// if it had arrived on its own. They all belong to one frame, so at most one
+// of them (the END, last) completes it.
+bool FrameAssembler::push_agg(const chunk_hdr_t &outer, const uint8_t *p, size_t len,
+                              uint64_t now_ns, FrameView &out)
+{
+    if (outer.payload_len > len)
+    {
+        stats_.bad_datagrams++;
+        return false;
+    }
+    len = outer.payload_len;
+
+    // Validate the whole layout before taking any chunk from it
+    unsigned count = 0;
+    size_t off = 0;
+    while (off + CHUNK_AGG_SUBHDR_LEN <= len)
+    {
+        uint16_t sub_len = chunk_rd16(p + off + 4);
+        if (sub_len > CHUNK_PAYLOAD_MAX || (p[off + 3] & CHUNK_RSV_PARITY) ||
+            sub_len > len - off - CHUNK_AGG_SUBHDR_LEN)
+            break;
+        off += CHUNK_AGG_SUBHDR_LEN + sub_len;
+        count++;
+    }
+    if (off != len || count == 0 || count != outer.rsv)
+    {
+        stats_.bad_datagrams++;
+        return false;
+    }
+    stats_.agg_datagrams++;
+
+    bool done = false;
+    for (off = 0; off < len;)
+    {
+        chunk_hdr_t h;
+        chunk_agg_sub_parse(p + off, outer.frame_id, &h);
+        off += CHUNK_AGG_SUBHDR_LEN;
+        done |= push_chunk(h, p + off, now_ns, out);
+        off += h.payload_len;
+    }
+    return done;
+}
+
+bool FrameAssembler::push_chunk(const chunk_hdr_t &h, const uint8_t *payload, uint64_t now_ns,
+                                FrameView &out)
+{
+    bool is_parity = is_parity_chunk(h);
+
+    // Frame data only from here on; timestamps are kept per slot
+    chunk_ext_t ext = {};
+    uint16_t len = h.payload_len;
+    if (!is_parity && (h.flags & CHUNK_FLAG_CRC))
+    {
+        if (len < CHUNK_CRC_LEN)
+        {
+            stats_.bad_datagrams++;
+            return false;
+        }
+        if (cfg_.check_crc && !chunk_crc_ok(&h, payload))
+        {
+            stats_.crc_bad++;
+            return false;
+        }
+        len = uint16_t(len - CHUNK_CRC_LEN);
+    }
+    if (!is_parity && (h.flags & CHUNK_FLAG_EXT))
+    {
+        if (chunk_ext_parse(payload, len, &ext) != 0)
+        {
+            stats_.bad_datagrams++;
+            return false;
+        }
+        payload += ext.len;
+        len = uint16_t(len - ext.len);
+    }
+
+    if (have_done_ && !seq_before(last_done_, h.frame_id))
+    {
+        // A START further back than the slots reach could never be assembled
+        // anyway: the sender restarted its frame counter. (A resend is never
+        // a restart, however old.)
+        if ((h.flags & (CHUNK_FLAG_START | CHUNK_FLAG_RETX)) == CHUNK_FLAG_START &&
+            last_done_ - h.frame_id >= cfg_.slots)
+        {
+            // Sender restarted: forget everything from the old sequence
+            stats_.restarts++;
+            have_done_ = false;
+            for (Slot &slot : slots_)
+                slot.active = false;
+        }
+        else if (is_parity)
+        {
+            stats_.parity_unused++;
+            return false;
+        }
+        else
+        {
+            stats_.late_chunks++;
+            return false;
+        }
+    }
+
+    if (!is_parity && h.chunk_id >= cfg_.max_chunks)
+    {
+        stats_.oversize_chunks++;
+        return false;
+    }
+
+    Slot &slot = slots_[h.frame_id % slots_.size()];
+
+    if (!slot.active || slot.frame_id != h.frame_id)
+    {
+        if (slot.active)
+        {
+            if (seq_before(h.frame_id, slot.frame_id))
+            {
+                stats_.late_chunks++;
+                return false;
+            }
+            stats_.overwritten++;
+        }
+        open(slot, h.frame_id, now_ns);
+    }
+
+    slot.last_ns = now_ns;
+
+    if (is_parity)
+    {
+        if (!push_parity(slot, h, payload) || !recover(slot))
+        {
+            slot.active = false;
+            return false;
+        }
+        return finish(slot, now_ns, out);
+    }
+
+    uint64_t bit = uint64_t(1) << (h.chunk_id % 64);
+    uint64_t &word = slot.bits[h.chunk_id / 64];
+    if (word & bit)
+    {
+        stats_.duplicates++;
+        return false;
+    }
+
+    if (h.flags & CHUNK_FLAG_END)
+    {
+        if ((slot.end_chunk != kNoEnd && slot.end_chunk != h.chunk_id) ||
+            (slot.n_data >= 0 && slot.n_data != h.chunk_id + 1))
+        {
+            stats_.inconsistent++;
+            slot.active = false;
+            return false;
+        }
+        slot.end_chunk = h.chunk_id;
+        slot.end_len = len;
+    }
+    else if ((slot.end_chunk != kNoEnd && h.chunk_id > slot.end_chunk) ||
+             (slot.n_data >= 0 && h.chunk_id >= slot.n_data))
+    {
+        stats_.inconsistent++;
+        slot.active = false;
+        return false;
+    }
+
+    if (!place(slot, h.chunk_id, payload, len))
+    {
+        slot.active = false;
+        return false;
+    }
+    word |= bit;
+    slot.received++;
+    if (h.flags & CHUNK_FLAG_EXT)
+    {
+        slot.stamped = true;
+        slot.capture_us = std::max(slot.capture_us, ext.capture_age_us);
+        slot.fwd_us = std::max(slot.fwd_us, ext.fwd_us);
+    }
+    if (int32_t(h.chunk_id) > slot.max_chunk)
+        slot.max_chunk = h.chunk_id;
+    if (h.flags & CHUNK_FLAG_RETX)
+        stats_.retx_chunks++;
+
+    if (!recover(slot))
+    {
+        slot.active = false;
+        return false;
+    }
+    return finish(slot, now_ns, out);
+}
+
+size_t FrameAssembler::nacks(uint64_t now_ns, Nack *out, size_t cap)
+{
+    size_t n = 0;
+    if (!cfg_.nack_after_ns)
+        return 0;
+
+    for (Slot &slot : slots_)
+    {
+        if (n == cap)
+            break;
+        if (!slot.active || slot.nacks >= cfg_.nack_max ||
+            now_ns - slot.last_ns < cfg_.nack_after_ns)
+            continue;
+
+        // Chunks that should exist: up to END or the parity's count if known,
+        // else one past the highest seen in case it was the END that went
+        int32_t limit = slot.end_chunk != kNoEnd ? slot.end_chunk + 1
+                        : slot.n_data >= 0       ? slot.n_data
+                                                 : slot.max_chunk + 2;
+        limit = std::min<int32_t>(limit, int32_t(cfg_.max_chunks));
+
+        Nack &nk = out[n];
+        int32_t base = -1;
+        std::memset(nk.bitmap, 0, sizeof(nk.bitmap));
+        for (int32_t i = 0; i < limit; i++)
+        {
+            if (slot.bits[i / 64] & (uint64_t(1) << (i % 64)))
+                continue;
+            if (base < 0)
+                base = i;
+            if (i - base >= CHUNK_NACK_BITMAP_MAX * 8)
+                break;
+            nk.bitmap[(i - base) / 8] |= uint8_t(1u << ((i - base) % 8));
+            nk.nbytes = uint8_t((i - base) / 8 + 1);
+        }
+        if (base < 0)
+            continue;
+
+        nk.frame_id = slot.frame_id;
+        nk.base = uint16_t(base);
+        slot.nacks++;
+        slot.last_ns = now_ns;
+        stats_.nacks++;
+        n++;
+    }
+    return n;
+}
@@ -0,0 +1,172 @@
+// pc/receiver/frame_assembler.hpp
+// Reassembles chunk datagrams (common/chunk_proto.h) into JPEG frames inside a
+// slab allocated once at construction. A frame lives in slot frame_id % slots;
+// each chunk is copied once, straight to chunk_id * stride in that slot, where
+// stride is the payload size of any non-END chunk (the K210 sends fixed-size
+// chunks, only the last one is shorter). No heap allocation per chunk or frame.
+//
+// Aggregated datagrams (CHUNK_FLAG_AGG) are unpacked and each chunk in them is
+// handled exactly like a chunk that came on its own.
+//
+// Chunks may arrive in any order. A per-slot bitmap records which chunk_ids are
+// in; duplicates are dropped without a copy, and a frame is emitted only once
+// every chunk from 0 (START) to the END chunk is present, so nothing downstream
+// ever decodes a frame with holes in it.
+//
+// The slots are a bounded reassembly window. An unfinished frame leaves it when
+//   - a newer frame completes (sequence eviction: its END is not coming),
+//   - it is older than max_age_ns (age eviction),
+//   - a newer frame maps onto its slot (overwritten),
+//   - its chunks contradict each other (inconsistent).
+// Chunks for frames at or before the newest completed one are dropped as late,
+// so memory and state stay flat no matter how many chunks go missing.
+//
+// FEC (common/fec.h): parity chunks are kept per slot next to the data. Once
+// the parity in hand covers the data chunks still missing, those are rebuilt
+// from it and placed like received ones. Parity that arrives after its frame
+// completed is counted, not stored.
+//
+// Timestamps: chunks with the extension (CHUNK_FLAG_EXT) have it stripped
+// before placement; the frame reports the largest capture_age_us and fwd_us of
+// its chunks plus how long it took from its first datagram to completion.
+//
+// CRC: a chunk with a CRC trailer (CHUNK_FLAG_CRC) that does not match is
+// dropped like a lost one, so NACK or FEC can still replace it; the trailer is
+// stripped before placement either way.
+//
+// NACKs: with nack_after_ns set, nacks() lists the holes of unfinished frames
+// that have gone that long without a chunk, for the caller to send back to the
+// forwarder (chunk_proto.h). A frame is NACKed at most nack_max times.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "chunk_proto.h"
+
+struct FrameView
+{
+    uint32_t frame_id;
+    const uint8_t *data;
+    size_t size;
+    // Per-stage latency (chunk_proto.h timestamp extension)
+    bool stamped = false;    // some chunk carried the extension
+    uint32_t capture_us = 0; // K210 snapshot -> last chunk on SPI
+    uint32_t fwd_us = 0;     // ESP32 SPI -> sendto(), slowest chunk (0 = not stamped)
+    uint64_t assemble_ns = 0; // first datagram in -> frame complete
+};
+
+class FrameAssembler
+{
+public:
+    struct Config
+    {
+        size_t slots = 8;
+        size_t max_frame_bytes = 256 * 1024;
+        size_t max_chunks = 256; // per frame; bitmap size
+        uint64_t max_age_ns = 500'000'000;
+        uint64_t nack_after_ns = 0; // 0 = no NACKs
+        unsigned nack_max = 3;
+        bool check_crc = true; // false: strip CRC trailers unchecked
+    };
+
+    struct Stats
+    {
+        uint64_t datagrams = 0;
+        uint64_t bad_datagrams = 0;   // short, or payload_len past the datagram
+        uint64_t frames = 0;          // completed
+        uint64_t duplicates = 0;      // chunk_id already received
+        uint64_t oversize_chunks = 0; // past max_chunks / max_frame_bytes
+        uint64_t inconsistent = 0;    // frame dropped: chunk sizes/END disagree
+        uint64_t overwritten = 0;     // unfinished frame replaced by a newer one
+        uint64_t evicted_stale = 0;   // unfinished frame passed by a newer complete one
+        uint64_t evicted_aged = 0;    // unfinished frame older than max_age_ns
+        uint64_t late_chunks = 0;     // for a frame at or before the newest completed
+        uint64_t restarts = 0;        // sender frame_id jumped back past the slots
+        uint64_t parity_chunks = 0;   // FEC parity received and stored
+        uint64_t parity_unused = 0;   // parity for a frame already complete
+        uint64_t fec_recovered = 0;   // data chunks rebuilt from parity
+        uint64_t fec_frames = 0;      // frames that completed thanks to FEC
+        uint64_t fec_failed = 0;      // frame dropped: decode gave bad blocks
+        uint64_t nacks = 0;           // NACKs handed out by nacks()
+        uint64_t retx_chunks = 0;     // CHUNK_FLAG_RETX chunks that filled a hole
+        uint64_t agg_datagrams = 0;   // datagrams carrying several chunks
+        uint64_t crc_bad = 0;         // chunks dropped: CRC trailer did not match
+    };
+
+    struct Nack
+    {
+        uint32_t frame_id;
+        uint16_t base;
+        uint8_t nbytes;
+        uint8_t bitmap[CHUNK_NACK_BITMAP_MAX];
+    };
+
+    FrameAssembler() : FrameAssembler(Config()) {}
+    explicit FrameAssembler(const Config &cfg);
+
+    // Feed one datagram received at now_ns (any monotonic clock). Returns true
+    // when it completed a frame; `out` points into the slab and stays valid
+    // until that slot is reused.
+    bool push(const uint8_t *dgram, size_t len, uint64_t now_ns, FrameView &out);
+
+    // Age-evict unfinished frames; call when idle so nothing lingers
+    void expire(uint64_t now_ns);
+
+    // Fill up to cap NACKs for frames due one (see nack_after_ns); returns how many
+    size_t nacks(uint64_t now_ns, Nack *out, size_t cap);
+
+    const Stats &stats() const { return stats_; }
+
+private:
+    static constexpr int32_t kNoEnd = -1;
+
+    struct Slot
+    {
+        uint32_t frame_id = 0;
+        bool active = false;
+        uint16_t stride = 0;   // 0 until a non-END chunk is seen
+        uint16_t received = 0; // distinct chunks in
+        int32_t end_chunk = kNoEnd;
+        uint16_t end_len = 0;
+        bool end_parked = false; // END arrived before stride was known
+        uint64_t started_ns = 0;
+        uint8_t *data = nullptr;
+        uint8_t *parked = nullptr; // CHUNK_PAYLOAD_MAX bytes for a parked END
+        uint64_t *bits = nullptr;  // max_chunks bits
+        int32_t n_data = -1;       // data chunks, once a parity chunk told us
+        uint8_t parity_have = 0;   // bit j: parity j stored
+        uint16_t parity_len = 0;
+        uint8_t *parity = nullptr; // FEC_MAX_PARITY blocks of FEC_BLOCK_MAX
+        uint64_t last_ns = 0;      // last chunk in, or last NACK out
+        int32_t max_chunk = -1;    // highest data chunk_id seen
+        uint8_t nacks = 0;
+        bool stamped = false;      // timestamps, max over the frame's chunks
+        uint32_t capture_us = 0;
+        uint32_t fwd_us = 0;
+    };
+
+    void open(Slot &slot, uint32_t frame_id, uint64_t now_ns);
+    bool place(Slot &slot, uint16_t chunk_id, const uint8_t *payload, uint16_t len);
+    bool push_agg(const chunk_hdr_t &outer, const uint8_t *p, size_t len, uint64_t now_ns,
+                  FrameView &out);
+    bool push_chunk(const chunk_hdr_t &h, const uint8_t *payload, uint64_t now_ns, FrameView &out);
+    bool push_parity(Slot &slot, const chunk_hdr_t &h, const uint8_t *payload);
+    bool recover(Slot &slot);
+    bool finish(Slot &slot, uint64_t now_ns, FrameView &out);
+    void evict_older_than(uint32_t frame_id);
+
+    Config cfg_;
+    size_t bitmap_words_;
+    bool have_done_ = false;
+    uint32_t last_done_ = 0;
+    std::vector<uint8_t> slab_;
+    std::vector<uint8_t> parked_;
+    std::vector<uint64_t> bitmaps_;
+    std::vector<uint8_t> parity_;
+    std::vector<uint8_t> fec_out_; // decode scratch, FEC_MAX_PARITY blocks
+    std::vector<Slot> slots_;
+    Stats stats_;
+};
@@ -0,0 +1,71 @@
+// pc/receiver/frame_ring.cpp
+
+#include "frame_ring.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+FrameRing::FrameRing(const std::string &path, uint32_t slots, size_t max_frame_bytes)
+    : slots_(slots),
+      slot_bytes_(uint32_t((FRAME_RING_SLOT_HDR_BYTES + max_frame_bytes + 63) & ~size_t(63)))
+{
+    map_len_ = FRAME_RING_HDR_BYTES + size_t(slots_) * slot_bytes_;
+
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), path);
+    if (ftruncate(fd, off_t(map_len_)) < 0)
+    {
+        int err = errno;
+        close(fd);
+        throw std::system_error(err, std::generic_category(), "ftruncate " + path);
+    }
+    void *p = mmap(nullptr, map_len_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        throw std::system_error(errno, std::generic_category(), "mmap " + path);
+    map_ = static_cast<uint8_t *>(p);
+
+    auto *hdr = reinterpret_cast<frame_ring_hdr_t *>(map_);
+    std::memset(map_, 0, map_len_);
+    std::memcpy(hdr->magic, FRAME_RING_MAGIC, sizeof(FRAME_RING_MAGIC));
+    hdr->version = FRAME_RING_VERSION;
+    hdr->slots = slots_;
+    hdr->slot_bytes = slot_bytes_;
+}
+
+FrameRing::~FrameRing()
+{
+    if (map_)
+        munmap(map_, map_len_);
+}
+
+void FrameRing::publish(const FrameView &f, uint64_t stamp_ns)
+{
+    if (f.size > slot_bytes_ - FRAME_RING_SLOT_HDR_BYTES)
+    {
+        skipped_++;
+        return;
+    }
+
+    auto *hdr = reinterpret_cast<frame_ring_hdr_t *>(map_);
+    uint64_t n = hdr->write_count;
+    uint8_t *base = map_ + FRAME_RING_HDR_BYTES + size_t(n % slots_) * slot_bytes_;
+    auto *slot = reinterpret_cast<frame_ring_slot_t *>(base);
+
+    __atomic_store_n(&slot->seq, 2 * n + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    slot->frame_id = f.frame_id;
+    slot->size = uint32_t(f.size);
+    slot->stamp_ns = stamp_ns;
+    std::memcpy(base + FRAME_RING_SLOT_HDR_BYTES, f.data, f.size);
+
+    __atomic_store_n(&slot->seq, 2 * n + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&hdr->write_count, n + 1, __ATOMIC_RELEASE);
+}
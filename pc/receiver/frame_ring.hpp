@@ -0,0 +1,36 @@
+// pc/receiver/frame_ring.hpp
+// Writer side of the shared-memory frame ring (layout: common/frame_ring.h).
+// The file is created (or resized) and mapped once; publish() is a seqlocked
+// memcpy into the next slot with no syscalls.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "frame_assembler.hpp"
+#include "frame_ring.h"
+
+class FrameRing
+{
+public:
+    // Create/resize PATH (e.g. /dev/shm/lvrecv.ring) and map it. Frames larger
+    // than max_frame_bytes are skipped. Throws std::system_error.
+    FrameRing(const std::string &path, uint32_t slots, size_t max_frame_bytes);
+    ~FrameRing();
+
+    FrameRing(const FrameRing &) = delete;
+    FrameRing &operator=(const FrameRing &) = delete;
+
+    void publish(const FrameView &f, uint64_t stamp_ns);
+
+    uint64_t skipped() const { return skipped_; }
+
+private:
+    uint8_t *map_ = nullptr;
+    size_t map_len_ = 0;
+    uint32_t slots_;
+    uint32_t slot_bytes_;
+    uint64_t skipped_ = 0;
+};
@@ -0,0 +1,79 @@
+// pc/receiver/latest_writer.cpp
+
+#include "latest_writer.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+LatestWriter::LatestWriter(std::string path, double max_hz)
+    : path_(std::move(path)),
+      tmp_path_(path_ + ".tmp"),
+      min_gap_ns_(max_hz > 0 ? uint64_t(1e9 / max_hz) : 0)
+{
+}
+
+bool LatestWriter::due(uint64_t now_ns) const
+{
+    return !have_last_ || now_ns - last_ns_ >= min_gap_ns_;
+}
+
+void LatestWriter::offer(const FrameView &f, uint64_t now_ns)
+{
+    if (due(now_ns))
+    {
+        write(f.data, f.size, now_ns);
+        pending_ = false;
+        return;
+    }
+    held_.assign(f.data, f.data + f.size);
+    pending_ = true;
+}
+
+void LatestWriter::poll(uint64_t now_ns)
+{
+    if (pending_ && due(now_ns))
+    {
+        write(held_.data(), held_.size(), now_ns);
+        pending_ = false;
+    }
+}
+
+void LatestWriter::write(const uint8_t *data, size_t size, uint64_t now_ns)
+{
+    last_ns_ = now_ns;
+    have_last_ = true;
+
+    int fd = open(tmp_path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        std::perror(tmp_path_.c_str());
+        return;
+    }
+    size_t off = 0;
+    while (off < size)
+    {
+        ssize_t w = ::write(fd, data + off, size - off);
+        if (w < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            std::perror(tmp_path_.c_str());
+            close(fd);
+            unlink(tmp_path_.c_str());
+            return;
+        }
+        off += size_t(w);
+    }
+    close(fd);
+
+    if (rename(tmp_path_.c_str(), path_.c_str()) < 0)
+    {
+        std::perror(path_.c_str());
+        return;
+    }
+    written_++;
+}
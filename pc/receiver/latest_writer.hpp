@@ -0,0 +1,42 @@
+// pc/receiver/latest_writer.hpp
+// Throttled, atomic "latest frame" file: the JPEG is written to PATH.tmp and
+// rename()d over PATH, so a watcher never sees a torn file, and at most
+// max_hz files are written per second. A frame that arrives inside the
+// throttle window is kept and written once the window opens (poll()), so the
+// file always catches up with the newest frame when the stream pauses.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "frame_assembler.hpp"
+
+class LatestWriter
+{
+public:
+    // max_hz <= 0: write every frame
+    LatestWriter(std::string path, double max_hz);
+
+    // Offer a completed frame at now_ns (steady clock)
+    void offer(const FrameView &f, uint64_t now_ns);
+
+    // Write a held-back frame if its window has opened
+    void poll(uint64_t now_ns);
+
+    uint64_t written() const { return written_; }
+
+private:
+    bool due(uint64_t now_ns) const;
+    void write(const uint8_t *data, size_t size, uint64_t now_ns);
+
+    std::string path_;
+    std::string tmp_path_;
+    uint64_t min_gap_ns_;
+    uint64_t last_ns_ = 0;
+    bool have_last_ = false;
+    bool pending_ = false;
+    std::vector<uint8_t> held_; // capacity reused, no allocation once warm
+    uint64_t written_ = 0;
+};
@@ -0,0 +1,328 @@
+// pc/receiver/lvcap.cpp
+// lvcap: record the chunk stream to a capture file (common/capture.h) and
+// replay it deterministically, for throughput and latency runs on real K210
+// traffic instead of synthetic frames.
+//
+//   lvcap record [--port 5006] [--seconds N] FILE
+//   lvcap replay [--host 127.0.0.1] [--port 5006] [--speed X | --flat] FILE
+//   lvcap info FILE
+//
+// record takes the port for itself; to record while lvrecv is running use
+// lvrecv --record FILE instead. replay sends every datagram from one socket per
+// source address of the recording, so lvrecv sees as many streams as it did
+// in the field, and paces them to their recorded arrival times (--speed 2 =
+// twice as fast, --flat = no pacing at all). It reports how late sends were
+// against that schedule. Frame ids repeat between replays, so give each run
+// a fresh lvrecv. info summarises a capture per source.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <map>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "capture_file.hpp"
+#include "chunk_proto.h"
+#include "udp_rx.hpp"
+
+using lv_clock = std::chrono::steady_clock;
+
+static std::atomic<bool> g_stop{false};
+
+static void on_signal(int) { g_stop = true; }
+
+static uint64_t now_ns()
+{
+    return uint64_t(lv_clock::now().time_since_epoch() / std::chrono::nanoseconds(1));
+}
+
+static void usage(const char *argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s record [--port N] [--seconds N] FILE\n"
+                 "       %s replay [--host IP] [--port N] [--speed X | --flat] FILE\n"
+                 "       %s info FILE\n",
+                 argv0, argv0, argv0);
+}
+
+static std::string addr_str(const sockaddr_in &a)
+{
+    char ip[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &a.sin_addr, ip, sizeof(ip));
+    return std::string(ip) + ":" + std::to_string(ntohs(a.sin_port));
+}
+
+static uint64_t addr_key(const sockaddr_in &a)
+{
+    return uint64_t(a.sin_addr.s_addr) << 16 | a.sin_port;
+}
+
+// log2 histogram of how late sends were: bucket i counts delays < 2^i us (the
+// last one everything beyond), so a long replay takes no more memory
+struct LateHist
+{
+    static const int kBuckets = 32;
+    uint64_t n[kBuckets] = {};
+    uint64_t count = 0, max_us = 0;
+
+    void add(uint64_t us)
+    {
+        int i = 0;
+        while (i < kBuckets - 1 && us >= (uint64_t(1) << i))
+            i++;
+        n[i]++;
+        count++;
+        max_us = std::max(max_us, us);
+    }
+
+    // Upper bound of the bucket holding quantile q
+    uint64_t below(double q) const
+    {
+        uint64_t want = uint64_t(q * double(count)), acc = 0;
+        for (int i = 0; i < kBuckets; i++)
+        {
+            acc += n[i];
+            if (acc > want || acc == count)
+                return uint64_t(1) << i;
+        }
+        return uint64_t(1) << (kBuckets - 1);
+    }
+};
+
+static int cmd_record(uint16_t port, double seconds, const std::string &path)
+{
+    UdpRx rx(port, 16 << 20);
+    CaptureWriter cap(path, rx.port());
+    std::printf("[lvcap] recording port %u to %s\n", rx.port(), path.c_str());
+
+    uint64_t t0 = now_ns(), last_log = t0;
+    while (!g_stop)
+    {
+        int n = rx.recv();
+        uint64_t t = now_ns();
+        cap.add(rx, n, t);
+        if (seconds > 0 && t - t0 >= uint64_t(seconds * 1e9))
+            break;
+        if (t - last_log >= 1000000000ull)
+        {
+            cap.flush();
+            std::printf("[lvcap] %llu datagrams, %.1f MB\n", (unsigned long long)cap.records(),
+                        cap.bytes() / 1e6);
+            last_log = t;
+        }
+    }
+    cap.flush();
+    std::printf("[lvcap] %llu datagrams, %.1f MB in %s\n", (unsigned long long)cap.records(),
+                cap.bytes() / 1e6, path.c_str());
+    return 0;
+}
+
+static int cmd_replay(const std::string &host, uint16_t port, double speed,
+                      const std::string &path)
+{
+    CaptureReader cap(path);
+    sockaddr_in dst = {};
+    dst.sin_family = AF_INET;
+    dst.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &dst.sin_addr) != 1)
+    {
+        std::fprintf(stderr, "[lvcap] bad host %s\n", host.c_str());
+        return 2;
+    }
+
+    // One sending socket per recorded source
+    std::map<uint64_t, int> socks;
+    CaptureReader::Record r;
+    while (cap.next(r))
+    {
+        if (socks.count(addr_key(r.src)))
+            continue;
+        int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&dst), sizeof(dst)) < 0)
+            throw std::system_error(errno, std::generic_category(), "socket");
+        socks[addr_key(r.src)] = fd;
+    }
+    cap.rewind();
+
+    LateHist late;
+    uint64_t sent = 0, failed = 0, bytes = 0;
+    uint64_t t0 = now_ns() + 1000000; // a little lead so the first sends are on time
+    while (!g_stop && cap.next(r))
+    {
+        if (speed > 0)
+        {
+            uint64_t due = t0 + uint64_t(double(r.t_ns) / speed);
+            uint64_t t = now_ns();
+            if (t < due)
+            {
+                std::this_thread::sleep_until(lv_clock::time_point(std::chrono::nanoseconds(due)));
+                t = now_ns();
+            }
+            late.add((t - std::min(t, due)) / 1000);
+        }
+        if (send(socks[addr_key(r.src)], r.data, r.len, 0) == ssize_t(r.len))
+        {
+            sent++;
+            bytes += r.len;
+        }
+        else
+        {
+            failed++;
+        }
+    }
+    double dt = (now_ns() - t0) / 1e9;
+    for (const auto &kv : socks)
+        close(kv.second);
+
+    std::printf("[lvcap] replayed %llu datagrams (%llu failed) from %zu sources in %.3f s: "
+                "%.0f dgrams/s %.1f MB/s\n",
+                (unsigned long long)sent, (unsigned long long)failed, socks.size(), dt,
+                dt > 0 ? sent / dt : 0.0, dt > 0 ? bytes / dt / 1e6 : 0.0);
+    if (late.count)
+        std::printf("[lvcap] pacing x%.2f, late p50<%llu us p99<%llu us max=%llu us\n", speed,
+                    (unsigned long long)late.below(0.5), (unsigned long long)late.below(0.99),
+                    (unsigned long long)late.max_us);
+    return failed ? 1 : 0;
+}
+
+static int cmd_info(const std::string &path)
+{
+    CaptureReader cap(path);
+    const capture_hdr_t &h = cap.header();
+
+    struct Source
+    {
+        sockaddr_in addr;
+        uint64_t datagrams = 0, bytes = 0, frames = 0;
+    };
+    std::map<uint64_t, Source> sources;
+    CaptureReader::Record r;
+    uint64_t n = 0, first_ns = 0, last_ns = 0;
+    while (cap.next(r))
+    {
+        if (n == 0)
+            first_ns = r.t_ns;
+        Source &s = sources[addr_key(r.src)];
+        s.addr = r.src;
+        s.datagrams++;
+        s.bytes += r.len;
+        if (r.len >= CHUNK_HDR_LEN)
+        {
+            chunk_hdr_t ch;
+            chunk_hdr_parse(r.data, &ch);
+            if ((ch.flags & CHUNK_FLAG_START) && !(ch.flags & CHUNK_FLAG_AGG))
+                s.frames++;
+            else if ((ch.flags & CHUNK_FLAG_AGG) && r.len >= CHUNK_HDR_LEN + CHUNK_AGG_SUBHDR_LEN &&
+                     (r.data[CHUNK_HDR_LEN + 2] & CHUNK_FLAG_START))
+                s.frames++;
+        }
+        n++;
+        last_ns = r.t_ns;
+    }
+
+    time_t wall = time_t(h.start_wall_ns / 1000000000ull);
+    char when[64];
+    std::strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", std::localtime(&wall));
+    double dur = (last_ns - first_ns) / 1e9;
+    std::printf("[lvcap] %s: port %u, started %s, %.3f s, %llu datagrams%s\n", path.c_str(), h.port,
+                when, dur, (unsigned long long)n,
+                cap.trailing() ? " (torn last record)" : "");
+    for (const auto &kv : sources)
+    {
+        const Source &s = kv.second;
+        std::printf("[lvcap]   %-21s %8llu dgrams %8.1f kB/s %6llu frames %5.1f fps\n",
+                    addr_str(s.addr).c_str(), (unsigned long long)s.datagrams,
+                    dur > 0 ? s.bytes / dur / 1e3 : 0.0, (unsigned long long)s.frames,
+                    dur > 0 ? s.frames / dur : 0.0);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    std::string cmd = argv[1];
+    std::string host = "127.0.0.1";
+    uint16_t port = 5006;
+    double seconds = 0;
+    double speed = 1.0;
+
+    static const option opts[] = {
+        {"port", required_argument, nullptr, 'p'},
+        {"seconds", required_argument, nullptr, 't'},
+        {"host", required_argument, nullptr, 'H'},
+        {"speed", required_argument, nullptr, 'x'},
+        {"flat", no_argument, nullptr, 'f'},
+        {nullptr, 0, nullptr, 0},
+    };
+    optind = 2;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "p:t:H:x:f", opts, nullptr)) != -1)
+    {
+        switch (opt)
+        {
+        case 'p':
+            port = uint16_t(std::atoi(optarg));
+            break;
+        case 't':
+            seconds = std::atof(optarg);
+            break;
+        case 'H':
+            host = optarg;
+            break;
+        case 'x':
+            speed = std::atof(optarg);
+            break;
+        case 'f':
+            speed = 0;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (optind != argc - 1 || speed < 0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    std::string path = argv[optind];
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    try
+    {
+        if (cmd == "record")
+            return cmd_record(port, seconds, path);
+        if (cmd == "replay")
+            return cmd_replay(host, port, speed, path);
+        if (cmd == "info")
+            return cmd_info(path);
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "[lvcap] %s\n", e.what());
+        return 1;
+    }
+    usage(argv[0]);
+    return 2;
+}
@@ -0,0 +1,358 @@
+// pc/receiver/main.cpp
+// lvrecv: receive chunk datagrams from the ESP32-C3 forwarders, reassemble
+// JPEG frames and hand them to the outputs:
+//   - MJPEG over HTTP (--http-port, default 8080; 0 = off)
+//   - latest.jpg, written atomically at most --out-hz times/s (--out "" = off)
+//   - a shared-memory ring of recent frames (--ring /dev/shm/lvrecv.ring)
+//
+// Several cameras may send to the one port (stream_demux.hpp): each gets its
+// own reassembly state, keyed by the stream_id in its chunks or else by its
+// address, and is numbered in order of appearance. Stream N is served at
+// http://.../N and written to latest-N.jpg (stream 0 keeps / and latest.jpg);
+// the ring carries stream 0 only. --workers N shards the streams over N
+// threads fed by the receive thread; the default 0 does everything on the
+// receive thread. --reuseport N instead opens N SO_REUSEPORT sockets on the
+// port, one per worker thread (0 = one per CPU), so receiving scales too;
+// --pin puts worker i on CPU i.
+//
+// Senders that stamp chunks (chunk_proto.h CHUNK_FLAG_EXT) get a latency line
+// per second with p50/p99 of each stage: K210 capture -> SPI, ESP32 SPI ->
+// UDP, and UDP -> assembled frame here.
+//
+// --record FILE appends every datagram received, with its arrival time, to a
+// capture file (common/capture.h) for lvcap replay.
+//
+// --nack-ms N asks the forwarder to resend chunks of a frame that has had no
+// chunk for N ms (chunk_proto.h NACK, sent to the chunks' source address).
+//
+//   lvrecv [--port 5006] [--out latest.jpg] [--out-hz 10] [--ring PATH]
+//          [--ring-slots 8] [--slots N] [--max-frame-bytes N] [--max-age-ms N]
+//          [--http-port 8080] [--http-addr 127.0.0.1] [--nack-ms N]
+//          [--workers N | --reuseport N] [--pin] [--max-streams 64]
+//          [--record FILE]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <stdexcept>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <getopt.h>
+
+#include "capture_file.hpp"
+#include "chunk_proto.h"
+#include "frame_assembler.hpp"
+#include "frame_ring.hpp"
+#include "latest_writer.hpp"
+#include "mjpeg_server.hpp"
+#include "stage_latency.hpp"
+#include "stream_demux.hpp"
+#include "udp_rx.hpp"
+
+static std::atomic<bool> g_stop{false};
+
+static void on_signal(int) { g_stop = true; }
+
+static void usage(const char *argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s [--port N] [--out FILE] [--out-hz N] [--ring PATH] [--ring-slots N]\n"
+                 "          [--slots N] [--max-frame-bytes N] [--max-age-ms N]\n"
+                 "          [--http-port N] [--http-addr IP] [--nack-ms N]\n"
+                 "          [--workers N | --reuseport N] [--pin] [--max-streams N]\n"
+                 "          [--record FILE]\n",
+                 argv0);
+}
+
+// latest.jpg for stream 0, latest-N.jpg for stream N
+static std::string stream_path(const std::string &path, uint32_t index)
+{
+    if (index == 0)
+        return path;
+    size_t dot = path.rfind('.');
+    size_t slash = path.rfind('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        dot = path.size();
+    return path.substr(0, dot) + "-" + std::to_string(index) + path.substr(dot);
+}
+
+// Outputs of one stream; touched only by the thread that owns the stream
+struct StreamOut
+{
+    std::unique_ptr<LatestWriter> latest;
+    std::atomic<uint32_t> last_id{0};
+    std::atomic<size_t> last_size{0};
+};
+
+int main(int argc, char **argv)
+{
+    uint16_t port = 5006;
+    std::string out_path = "latest.jpg";
+    double out_hz = 10;
+    std::string ring_path;
+    uint32_t ring_slots = 8;
+    uint16_t http_port = 8080;
+    std::string http_addr = "127.0.0.1";
+    StreamDemux::Config dcfg;
+    FrameAssembler::Config &cfg = dcfg.assembler;
+    bool reuse_port = false;
+    std::string record_path;
+
+    static const option opts[] = {
+        {"port", required_argument, nullptr, 'p'},
+        {"out", required_argument, nullptr, 'o'},
+        {"out-hz", required_argument, nullptr, 'z'},
+        {"ring", required_argument, nullptr, 'r'},
+        {"ring-slots", required_argument, nullptr, 'R'},
+        {"slots", required_argument, nullptr, 's'},
+        {"max-frame-bytes", required_argument, nullptr, 'm'},
+        {"max-age-ms", required_argument, nullptr, 'a'},
+        {"http-port", required_argument, nullptr, 'H'},
+        {"http-addr", required_argument, nullptr, 'A'},
+        {"nack-ms", required_argument, nullptr, 'N'},
+        {"workers", required_argument, nullptr, 'w'},
+        {"max-streams", required_argument, nullptr, 'S'},
+        {"reuseport", required_argument, nullptr, 'u'},
+        {"pin", no_argument, nullptr, 'P'},
+        {"record", required_argument, nullptr, 'c'},
+        {nullptr, 0, nullptr, 0},
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "p:o:z:r:R:s:m:a:H:A:N:w:S:u:Pc:", opts, nullptr)) != -1)
+    {
+        switch (opt)
+        {
+        case 'p':
+            port = uint16_t(std::atoi(optarg));
+            break;
+        case 'o':
+            out_path = optarg;
+            break;
+        case 'z':
+            out_hz = std::atof(optarg);
+            break;
+        case 'r':
+            ring_path = optarg;
+            break;
+        case 'R':
+            ring_slots = uint32_t(std::strtoul(optarg, nullptr, 0));
+            break;
+        case 's':
+            cfg.slots = std::strtoul(optarg, nullptr, 0);
+            break;
+        case 'm':
+            cfg.max_frame_bytes = std::strtoul(optarg, nullptr, 0);
+            break;
+        case 'a':
+            cfg.max_age_ns = std::strtoull(optarg, nullptr, 0) * 1000000ull;
+            break;
+        case 'H':
+            http_port = uint16_t(std::atoi(optarg));
+            break;
+        case 'A':
+            http_addr = optarg;
+            break;
+        case 'N':
+            cfg.nack_after_ns = std::strtoull(optarg, nullptr, 0) * 1000000ull;
+            break;
+        case 'w':
+            dcfg.workers = unsigned(std::strtoul(optarg, nullptr, 0));
+            break;
+        case 'S':
+            dcfg.max_streams = std::strtoul(optarg, nullptr, 0);
+            break;
+        case 'u':
+            reuse_port = true;
+            dcfg.workers = unsigned(std::strtoul(optarg, nullptr, 0));
+            if (dcfg.workers == 0)
+                dcfg.workers = std::max(std::thread::hardware_concurrency(), 1u);
+            break;
+        case 'P':
+            dcfg.pin = true;
+            break;
+        case 'c':
+            record_path = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (cfg.slots == 0 || cfg.max_frame_bytes == 0 || ring_slots == 0 || dcfg.max_streams == 0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    try
+    {
+        // With NACKs on, wake up often enough to send them in time
+        int rx_timeout_ms = cfg.nack_after_ns ? int(std::max<uint64_t>(cfg.nack_after_ns / 2000000, 1))
+                                              : 100;
+        dcfg.idle_ms = std::min(rx_timeout_ms, 100);
+
+        std::unique_ptr<MjpegServer> http;
+        if (http_port)
+        {
+            http = std::make_unique<MjpegServer>(http_addr, http_port, dcfg.max_streams);
+            std::printf("[pc] MJPEG at http://%s:%u/\n", http_addr.c_str(), http->port());
+        }
+
+        std::unique_ptr<FrameRing> ring;
+        if (!ring_path.empty())
+        {
+            ring = std::make_unique<FrameRing>(ring_path, ring_slots, cfg.max_frame_bytes);
+            std::printf("[pc] frame ring %s (%u slots)\n", ring_path.c_str(), ring_slots);
+        }
+
+        std::unique_ptr<CaptureWriter> record;
+        if (!record_path.empty())
+        {
+            record = std::make_unique<CaptureWriter>(record_path, port);
+            dcfg.record = record.get();
+            std::printf("[pc] recording to %s\n", record_path.c_str());
+        }
+
+        std::vector<StreamOut> outs(dcfg.max_streams);
+        auto on_frame = [&](StreamDemux::Stream &s, const FrameView &frame, uint64_t now_ns) {
+            StreamOut &o = outs[s.index];
+            if (s.assembler.stats().frames == 1)
+                std::printf("[pc] stream %u: %s\n", s.index, s.name.c_str());
+            if (http)
+                http->publish(frame, s.index);
+            if (ring && s.index == 0)
+                ring->publish(frame, now_ns);
+            if (!out_path.empty())
+            {
+                if (!o.latest)
+                    o.latest = std::make_unique<LatestWriter>(stream_path(out_path, s.index), out_hz);
+                o.latest->offer(frame, now_ns);
+            }
+            o.last_id.store(frame.frame_id, std::memory_order_relaxed);
+            o.last_size.store(frame.size, std::memory_order_relaxed);
+        };
+        auto on_tick = [&](StreamDemux::Stream &s, uint64_t now_ns) {
+            StreamOut &o = outs[s.index];
+            if (o.latest)
+                o.latest->poll(now_ns);
+        };
+        // --reuseport: the workers receive themselves, this thread only logs
+        std::unique_ptr<UdpRx> rx;
+        std::unique_ptr<StreamDemux> demux;
+        if (reuse_port)
+        {
+            demux = std::make_unique<StreamDemux>(dcfg, port, on_frame, on_tick);
+        }
+        else
+        {
+            rx = std::make_unique<UdpRx>(port, 4 << 20, dcfg.idle_ms);
+            demux = std::make_unique<StreamDemux>(dcfg, *rx, on_frame, on_tick);
+        }
+        std::printf("[pc] listening %u\n", demux->port());
+        if (dcfg.workers)
+            std::printf("[pc] %u workers%s%s, up to %zu streams\n", dcfg.workers,
+                        reuse_port ? " on SO_REUSEPORT sockets" : "", dcfg.pin ? ", pinned" : "",
+                        dcfg.max_streams);
+
+        using clock = std::chrono::steady_clock;
+        auto last_log = clock::now();
+        uint64_t last_frames = 0;
+        std::vector<uint64_t> frames, last_stream_frames;
+        StageLatency latency;
+
+        while (!g_stop)
+        {
+            if (rx)
+            {
+                int n = rx->recv();
+                uint64_t now_ns =
+                    uint64_t(clock::now().time_since_epoch() / std::chrono::nanoseconds(1));
+                demux->push(*rx, n, now_ns);
+                demux->poll(now_ns);
+            }
+            else
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                std::string err;
+                if (demux->failed(&err))
+                    throw std::runtime_error(err);
+            }
+            auto now = clock::now();
+
+            if (now - last_log >= std::chrono::seconds(1))
+            {
+                StreamDemux::Totals t = demux->totals(&frames);
+                const auto &st = t.sum;
+                double dt = std::chrono::duration<double>(now - last_log).count();
+                std::printf("[pc] %.1f fps frames=%llu datagrams=%llu bad=%llu late=%llu "
+                            "dup=%llu dropped=%llu fec=%llu nack=%llu retx=%llu last=%u bytes=%zu "
+                            "viewers=%zu",
+                            (st.frames - last_frames) / dt,
+                            (unsigned long long)st.frames,
+                            (unsigned long long)st.datagrams,
+                            (unsigned long long)st.bad_datagrams,
+                            (unsigned long long)st.late_chunks,
+                            (unsigned long long)st.duplicates,
+                            (unsigned long long)(st.overwritten + st.evicted_stale + st.evicted_aged +
+                                                 st.inconsistent + st.fec_failed),
+                            (unsigned long long)st.fec_frames,
+                            (unsigned long long)st.nacks,
+                            (unsigned long long)st.retx_chunks,
+                            outs[0].last_id.load(std::memory_order_relaxed),
+                            outs[0].last_size.load(std::memory_order_relaxed),
+                            http ? http->clients() : size_t(0));
+                if (st.crc_bad)
+                    std::printf(" crc=%llu", (unsigned long long)st.crc_bad);
+                if (t.streams > 1 || t.queue_drops || t.over_limit)
+                    std::printf(" streams=%zu qdrop=%llu over=%llu", t.streams,
+                                (unsigned long long)t.queue_drops,
+                                (unsigned long long)t.over_limit);
+                std::printf("\n");
+                if (t.streams > 1)
+                {
+                    last_stream_frames.resize(frames.size());
+                    std::printf("[pc] fps per stream:");
+                    for (size_t i = 0; i < frames.size(); i++)
+                    {
+                        std::printf(" %zu=%.1f", i, (frames[i] - last_stream_frames[i]) / dt);
+                        last_stream_frames[i] = frames[i];
+                    }
+                    std::printf("\n");
+                }
+                if (record)
+                    record->flush();
+                demux->take_latency(latency);
+                StageLatency::Summary lat = latency.take();
+                if (lat.n[StageLatency::kCapture])
+                {
+                    std::printf("[pc] latency p50/p99 ms:");
+                    for (int s = 0; s < StageLatency::kStages; s++)
+                    {
+                        if (lat.n[s])
+                            std::printf(" %s %.1f/%.1f", StageLatency::name(StageLatency::Stage(s)),
+                                        lat.p50_ms[s], lat.p99_ms[s]);
+                    }
+                    std::printf(" (%zu frames)\n", lat.n[StageLatency::kAssemble]);
+                }
+                last_frames = st.frames;
+                last_log = now;
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "[pc] %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
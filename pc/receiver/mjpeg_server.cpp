@@ -0,0 +1,393 @@
+// pc/receiver/mjpeg_server.cpp
+
+#include "mjpeg_server.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <system_error>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static const char kBoundary[] = "lvframe";
+
+static std::system_error sys_error(const char *what)
+{
+    return std::system_error(errno, std::generic_category(), what);
+}
+
+static uint64_t steady_ms()
+{
+    return uint64_t(std::chrono::steady_clock::now().time_since_epoch() /
+                    std::chrono::milliseconds(1));
+}
+
+MjpegServer::MjpegServer(const std::string &addr, uint16_t port, size_t channels)
+    : latest_(std::max<size_t>(channels, 1)), viewers_(latest_.size())
+{
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0)
+        throw sys_error("socket");
+
+    int one = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in sa = {};
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    if (inet_pton(AF_INET, addr.c_str(), &sa.sin_addr) != 1)
+    {
+        close(listen_fd_);
+        throw std::system_error(EINVAL, std::generic_category(), "http address " + addr);
+    }
+    if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&sa), sizeof(sa)) < 0 ||
+        listen(listen_fd_, 16) < 0)
+    {
+        auto err = sys_error("http bind/listen");
+        close(listen_fd_);
+        throw err;
+    }
+    socklen_t alen = sizeof(sa);
+    getsockname(listen_fd_, reinterpret_cast<sockaddr *>(&sa), &alen);
+    port_ = ntohs(sa.sin_port);
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || wake_fd_ < 0)
+        throw sys_error("epoll/eventfd");
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = listen_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &ev);
+    ev.data.fd = wake_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+
+    thread_ = std::thread(&MjpegServer::run, this);
+}
+
+MjpegServer::~MjpegServer()
+{
+    stop_ = true;
+    uint64_t one = 1;
+    (void)!write(wake_fd_, &one, sizeof(one));
+    if (thread_.joinable())
+        thread_.join();
+
+    for (auto &kv : clients_)
+        close(kv.first);
+    close(wake_fd_);
+    close(epoll_fd_);
+    close(listen_fd_);
+}
+
+void MjpegServer::publish(const FrameView &f, size_t channel)
+{
+    if (channel >= latest_.size() || viewers_[channel].load(std::memory_order_relaxed) == 0)
+        return;
+
+    auto frame = std::make_shared<Frame>();
+    char hdr[128];
+    int n = std::snprintf(hdr, sizeof(hdr),
+                          "--%s\r\nContent-Type: image/jpeg\r\nContent-Length: %zu\r\n\r\n",
+                          kBoundary, f.size);
+    frame->part_hdr.assign(hdr, size_t(n));
+    frame->jpeg.assign(f.data, f.data + f.size);
+
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (viewers_[channel].load(std::memory_order_relaxed) == 0)
+            return; // the last viewer left while we copied
+        frame->seq = ++seq_;
+        latest_[channel] = std::move(frame);
+    }
+    uint64_t one = 1;
+    (void)!write(wake_fd_, &one, sizeof(one));
+}
+
+void MjpegServer::run()
+{
+    epoll_event events[32];
+    uint64_t last_sweep_ms = steady_ms();
+
+    while (!stop_)
+    {
+        // Wake at least once a second while anyone is connected, to time out
+        // requests that never complete
+        int n = epoll_wait(epoll_fd_, events, 32, clients_.empty() ? -1 : 1000);
+        for (int i = 0; i < n; i++)
+        {
+            int fd = events[i].data.fd;
+            if (fd == listen_fd_)
+            {
+                accept_clients();
+                continue;
+            }
+            if (fd == wake_fd_)
+            {
+                uint64_t v;
+                (void)!read(wake_fd_, &v, sizeof(v));
+                // Idle clients pick up the new frame; busy ones get it when done
+                std::vector<int> gone;
+                for (auto &kv : clients_)
+                {
+                    Client &c = kv.second;
+                    if (!c.streaming || c.cur || !c.head.empty())
+                        continue;
+                    pick_latest(c);
+                    if (!flush(c))
+                        gone.push_back(c.fd);
+                }
+                for (int g : gone)
+                    drop(g);
+                continue;
+            }
+
+            auto it = clients_.find(fd);
+            if (it == clients_.end())
+                continue;
+            Client &c = it->second;
+            if (events[i].events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP))
+            {
+                drop(fd);
+                continue;
+            }
+            if (events[i].events & EPOLLIN)
+            {
+                on_readable(c);
+                if (clients_.find(fd) == clients_.end())
+                    continue;
+            }
+            if (events[i].events & EPOLLOUT)
+            {
+                if (!flush(c))
+                    drop(fd);
+            }
+        }
+
+        uint64_t now_ms = steady_ms();
+        if (now_ms - last_sweep_ms >= 1000)
+        {
+            last_sweep_ms = now_ms;
+            drop_stalled(now_ms);
+        }
+    }
+}
+
+void MjpegServer::drop_stalled(uint64_t now_ms)
+{
+    std::vector<int> gone;
+    for (const auto &kv : clients_)
+    {
+        const Client &c = kv.second;
+        if (!c.streaming && now_ms - c.accepted_ms >= kRequestTimeoutMs)
+            gone.push_back(c.fd);
+    }
+    static const char kTimeout[] = "HTTP/1.0 408 Request Timeout\r\nConnection: close\r\n\r\n";
+    for (int fd : gone)
+    {
+        (void)!send(fd, kTimeout, sizeof(kTimeout) - 1, MSG_NOSIGNAL);
+        drop(fd);
+    }
+}
+
+void MjpegServer::accept_clients()
+{
+    while (true)
+    {
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+
+        epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = fd;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+        Client c;
+        c.fd = fd;
+        c.accepted_ms = steady_ms();
+        clients_.emplace(fd, std::move(c));
+        n_clients_ = clients_.size();
+    }
+}
+
+void MjpegServer::on_readable(Client &c)
+{
+    char buf[1024];
+    ssize_t r = recv(c.fd, buf, sizeof(buf), 0);
+    if (r <= 0)
+    {
+        if (r == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+            drop(c.fd);
+        return;
+    }
+    if (c.streaming)
+        return; // ignore anything after the request
+
+    // The request may arrive in pieces; wait for the blank line that ends it
+    static const size_t kMaxRequest = 8192;
+    c.req.append(buf, size_t(r));
+    if (c.req.find("\r\n\r\n") == std::string::npos)
+    {
+        if (c.req.size() > kMaxRequest)
+        {
+            static const char kTooLarge[] =
+                "HTTP/1.0 431 Request Header Fields Too Large\r\nConnection: close\r\n\r\n";
+            (void)!send(c.fd, kTooLarge, sizeof(kTooLarge) - 1, MSG_NOSIGNAL);
+            drop(c.fd);
+        }
+        return;
+    }
+
+    if (c.req.compare(0, 4, "GET ") != 0)
+    {
+        static const char kBad[] = "HTTP/1.0 405 Method Not Allowed\r\nConnection: close\r\n\r\n";
+        (void)!send(c.fd, kBad, sizeof(kBad) - 1, MSG_NOSIGNAL);
+        drop(c.fd);
+        return;
+    }
+
+    // "GET /N ..." picks channel N; "GET / ..." channel 0
+    const char *path = c.req.c_str() + 4;
+    unsigned long ch = 0;
+    if (path[0] == '/' && path[1] >= '0' && path[1] <= '9')
+        ch = std::strtoul(path + 1, nullptr, 10);
+    if (ch >= latest_.size())
+    {
+        static const char kNotFound[] = "HTTP/1.0 404 Not Found\r\nConnection: close\r\n\r\n";
+        (void)!send(c.fd, kNotFound, sizeof(kNotFound) - 1, MSG_NOSIGNAL);
+        drop(c.fd);
+        return;
+    }
+
+    c.streaming = true;
+    c.channel = size_t(ch);
+    c.req.clear();
+    c.req.shrink_to_fit();
+    viewers_[c.channel]++;
+    c.head = std::string("HTTP/1.0 200 OK\r\n"
+                         "Content-Type: multipart/x-mixed-replace; boundary=") +
+             kBoundary +
+             "\r\n"
+             "Cache-Control: no-cache, no-store\r\n"
+             "Pragma: no-cache\r\n"
+             "Connection: close\r\n\r\n";
+    if (!flush(c))
+        drop(c.fd);
+}
+
+// Point an idle client at the newest frame it has not sent yet
+void MjpegServer::pick_latest(Client &c)
+{
+    std::lock_guard<std::mutex> lock(mu_);
+    const auto &latest = latest_[c.channel];
+    if (latest && latest->seq != c.last_seq)
+    {
+        c.cur = latest;
+        c.off = 0;
+    }
+}
+
+bool MjpegServer::flush(Client &c)
+{
+    while (!c.head.empty() || c.cur)
+    {
+        iovec iov[3];
+        int n = 0;
+        if (!c.head.empty())
+        {
+            iov[n++] = {&c.head[0], c.head.size()};
+        }
+        else
+        {
+            // part header | jpeg | CRLF, starting at c.off
+            static const char kCrlf[] = "\r\n";
+            const Frame &f = *c.cur;
+            size_t off = c.off;
+            const std::pair<const void *, size_t> parts[3] = {
+                {f.part_hdr.data(), f.part_hdr.size()},
+                {f.jpeg.data(), f.jpeg.size()},
+                {kCrlf, 2},
+            };
+            for (const auto &p : parts)
+            {
+                if (off >= p.second)
+                {
+                    off -= p.second;
+                    continue;
+                }
+                iov[n++] = {const_cast<char *>(static_cast<const char *>(p.first)) + off,
+                            p.second - off};
+                off = 0;
+            }
+        }
+
+        msghdr msg = {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = size_t(n);
+        ssize_t w = sendmsg(c.fd, &msg, MSG_NOSIGNAL);
+        if (w < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                set_want_out(c, true);
+                return true;
+            }
+            return false;
+        }
+
+        if (!c.head.empty())
+        {
+            c.head.erase(0, size_t(w));
+            if (c.head.empty())
+                pick_latest(c);
+            continue;
+        }
+
+        c.off += size_t(w);
+        if (c.off < c.cur->part_hdr.size() + c.cur->jpeg.size() + 2)
+            continue;
+
+        // Frame done: skip straight to the newest one, if any
+        c.last_seq = c.cur->seq;
+        c.cur.reset();
+        pick_latest(c);
+    }
+    set_want_out(c, false);
+    return true;
+}
+
+void MjpegServer::set_want_out(Client &c, bool on)
+{
+    if (c.want_out == on)
+        return;
+    c.want_out = on;
+    epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLRDHUP | (on ? uint32_t(EPOLLOUT) : 0u);
+    ev.data.fd = c.fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, c.fd, &ev);
+}
+
+void MjpegServer::drop(int fd)
+{
+    auto it = clients_.find(fd);
+    if (it != clients_.end() && it->second.streaming)
+    {
+        size_t ch = it->second.channel;
+        std::lock_guard<std::mutex> lock(mu_);
+        if (--viewers_[ch] == 0)
+            latest_[ch].reset(); // nobody left to send it to; never show it later
+    }
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    clients_.erase(fd);
+    n_clients_ = clients_.size();
+}
@@ -0,0 +1,96 @@
+// pc/receiver/mjpeg_server.hpp
+// Serves completed frames as a multipart/x-mixed-replace MJPEG stream over HTTP.
+//
+// publish() copies a frame out of the reassembly slab once into a refcounted
+// buffer (the part header is formatted into it too); every client streams from
+// that same buffer. A client holds at most the frame it is currently sending:
+// when it finishes, it jumps to whatever is newest, so a slow viewer skips
+// frames instead of queueing them. One epoll thread, non-blocking sockets.
+// A channel keeps its newest frame only while someone watches it, so a viewer
+// arriving after an idle spell never gets an old frame first. A connection
+// that has not sent a whole request within kRequestTimeoutMs is closed.
+//
+// Several cameras: channel N is served at /N, and / is channel 0.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "frame_assembler.hpp"
+
+class MjpegServer
+{
+public:
+    // Listen on addr:port, serving `channels` streams. Throws std::system_error.
+    MjpegServer(const std::string &addr, uint16_t port, size_t channels = 1);
+    ~MjpegServer();
+
+    MjpegServer(const MjpegServer &) = delete;
+    MjpegServer &operator=(const MjpegServer &) = delete;
+
+    // Hand a completed frame to all viewers. No copy is made while nobody is
+    // watching the channel. Thread-safe (several receive threads may publish).
+    void publish(const FrameView &f, size_t channel = 0);
+
+    size_t clients() const { return n_clients_.load(std::memory_order_relaxed); }
+    uint16_t port() const { return port_; }
+
+    static constexpr uint64_t kRequestTimeoutMs = 5000;
+
+private:
+    struct Frame
+    {
+        uint64_t seq;
+        std::string part_hdr;
+        std::vector<uint8_t> jpeg;
+    };
+
+    struct Client
+    {
+        int fd = -1;
+        bool streaming = false; // request seen, response header queued
+        size_t channel = 0;
+        std::string req;        // request received so far
+        uint64_t accepted_ms = 0; // steady clock, for kRequestTimeoutMs
+        std::string head;       // HTTP response header still to send
+        std::shared_ptr<const Frame> cur;
+        size_t off = 0; // into part_hdr + jpeg + "\r\n"
+        uint64_t last_seq = 0;
+        bool want_out = false;
+    };
+
+    void run();
+    void accept_clients();
+    void on_readable(Client &c);
+    void pick_latest(Client &c);
+    // Send as much as the socket takes; false when the client is gone
+    bool flush(Client &c);
+    void set_want_out(Client &c, bool on);
+    void drop(int fd);
+    // Close connections still without a whole request after kRequestTimeoutMs
+    void drop_stalled(uint64_t now_ms);
+
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+    uint16_t port_ = 0;
+    std::atomic<bool> stop_{false};
+    std::atomic<size_t> n_clients_{0};
+
+    std::mutex mu_; // guards latest_, seq_
+    std::vector<std::shared_ptr<const Frame>> latest_; // per channel
+    uint64_t seq_ = 0;
+    // Streaming clients per channel; written by the server thread, and only
+    // brought to 0 under mu_ (with latest_ reset)
+    std::vector<std::atomic<size_t>> viewers_;
+
+    std::unordered_map<int, Client> clients_; // server thread only
+    std::thread thread_;
+};
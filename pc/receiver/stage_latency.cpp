@@ -0,0 +1,61 @@
+// pc/receiver/stage_latency.cpp
+
+#include "stage_latency.hpp"
+
+#include <algorithm>
+
+const char *StageLatency::name(Stage s)
+{
+    switch (s)
+    {
+    case kCapture:
+        return "capture->spi";
+    case kForward:
+        return "spi->udp";
+    case kAssemble:
+        return "udp->frame";
+    default:
+        return "?";
+    }
+}
+
+void StageLatency::add(const FrameView &f)
+{
+    if (f.stamped)
+    {
+        us_[kCapture].push_back(f.capture_us);
+        if (f.fwd_us)
+            us_[kForward].push_back(f.fwd_us);
+    }
+    us_[kAssemble].push_back(uint32_t(std::min<uint64_t>(f.assemble_ns / 1000, UINT32_MAX)));
+}
+
+void StageLatency::absorb(StageLatency &other)
+{
+    for (int i = 0; i < kStages; i++)
+    {
+        us_[i].insert(us_[i].end(), other.us_[i].begin(), other.us_[i].end());
+        other.us_[i].clear();
+    }
+}
+
+StageLatency::Summary StageLatency::take()
+{
+    Summary s = {};
+    for (int i = 0; i < kStages; i++)
+    {
+        std::vector<uint32_t> &v = us_[i];
+        s.n[i] = v.size();
+        if (v.empty())
+            continue;
+        auto pct = [&](double p) {
+            auto it = v.begin() + ptrdiff_t(p * double(v.size() - 1));
+            std::nth_element(v.begin(), it, v.end());
+            return *it / 1e3;
+        };
+        s.p50_ms[i] = pct(0.50);
+        s.p99_ms[i] = pct(0.99);
+        v.clear();
+    }
+    return s;
+}
@@ -0,0 +1,48 @@
+// pc/receiver/stage_latency.hpp
+// Per-stage latency of completed frames, from the chunk timestamp extension
+// (chunk_proto.h CHUNK_FLAG_EXT) and the assembler's own clock, summarised as
+// p50/p99 per logging interval:
+//   capture   K210 snapshot -> last chunk on SPI
+//   forward   ESP32 SPI done -> sendto(), slowest chunk of the frame
+//   assemble  first datagram in -> frame complete
+// Frames without the extension only count towards `assemble`.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "frame_assembler.hpp"
+
+class StageLatency
+{
+public:
+    enum Stage
+    {
+        kCapture,
+        kForward,
+        kAssemble,
+        kStages
+    };
+
+    struct Summary
+    {
+        size_t n[kStages];
+        double p50_ms[kStages];
+        double p99_ms[kStages];
+    };
+
+    static const char *name(Stage s);
+
+    void add(const FrameView &f);
+
+    // Move other's samples over (several threads each fill their own)
+    void absorb(StageLatency &other);
+
+    // Percentiles of the frames added since the last call, then start over
+    Summary take();
+
+private:
+    std::vector<uint32_t> us_[kStages]; // capacity reused, no allocation once warm
+};
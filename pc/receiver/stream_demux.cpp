@@ -0,0 +1,412 @@
+// pc/receiver/stream_demux.cpp
+
+#include "stream_demux.hpp"
+
+#include "capture_file.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <system_error>
+
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <sched.h>
+
+static constexpr uint64_t kIdKey = uint64_t(1) << 48;
+
+static uint64_t steady_ns()
+{
+    return uint64_t(std::chrono::steady_clock::now().time_since_epoch() / std::chrono::nanoseconds(1));
+}
+
+static void add_stats(FrameAssembler::Stats &a, const FrameAssembler::Stats &b)
+{
+    a.datagrams += b.datagrams;
+    a.bad_datagrams += b.bad_datagrams;
+    a.frames += b.frames;
+    a.duplicates += b.duplicates;
+    a.oversize_chunks += b.oversize_chunks;
+    a.inconsistent += b.inconsistent;
+    a.overwritten += b.overwritten;
+    a.evicted_stale += b.evicted_stale;
+    a.evicted_aged += b.evicted_aged;
+    a.late_chunks += b.late_chunks;
+    a.restarts += b.restarts;
+    a.parity_chunks += b.parity_chunks;
+    a.parity_unused += b.parity_unused;
+    a.fec_recovered += b.fec_recovered;
+    a.fec_frames += b.fec_frames;
+    a.fec_failed += b.fec_failed;
+    a.nacks += b.nacks;
+    a.retx_chunks += b.retx_chunks;
+    a.agg_datagrams += b.agg_datagrams;
+    a.crc_bad += b.crc_bad;
+}
+
+uint64_t StreamDemux::id_key(const uint8_t *dgram, size_t len)
+{
+    if (len < CHUNK_HDR_LEN)
+        return 0;
+    chunk_hdr_t h;
+    chunk_hdr_parse(dgram, &h);
+    const uint8_t *p = dgram + CHUNK_HDR_LEN;
+    size_t left = len - CHUNK_HDR_LEN;
+    uint8_t flags = h.flags;
+    uint16_t plen = h.payload_len;
+    if (h.flags & CHUNK_FLAG_AGG)
+    {
+        // The first chunk inside speaks for the datagram
+        if (left < CHUNK_AGG_SUBHDR_LEN)
+            return 0;
+        chunk_hdr_t sub;
+        chunk_agg_sub_parse(p, h.frame_id, &sub);
+        flags = sub.flags;
+        plen = sub.payload_len;
+        p += CHUNK_AGG_SUBHDR_LEN;
+        left -= CHUNK_AGG_SUBHDR_LEN;
+    }
+    chunk_ext_t e;
+    if (!(flags & CHUNK_FLAG_EXT) || plen > left || chunk_ext_parse(p, plen, &e) != 0 ||
+        e.stream_id == 0)
+        return 0;
+    return kIdKey | e.stream_id;
+}
+
+uint64_t StreamDemux::addr_key(const sockaddr_in &src)
+{
+    return uint64_t(ntohl(src.sin_addr.s_addr)) << 16 | ntohs(src.sin_port);
+}
+
+StreamDemux::StreamDemux(const Config &cfg, UdpRx &reply, FrameFn on_frame, TickFn on_tick)
+    : cfg_(cfg), on_frame_(std::move(on_frame)), on_tick_(std::move(on_tick))
+{
+    unsigned n = std::max(cfg_.workers, 1u);
+    for (unsigned i = 0; i < n; i++)
+    {
+        workers_.push_back(std::make_unique<Worker>());
+        workers_.back()->reply = &reply;
+        if (cfg_.workers)
+            workers_.back()->ring.resize(std::max<size_t>(cfg_.queue_datagrams, 1));
+    }
+    if (cfg_.workers)
+    {
+        for (unsigned i = 0; i < n; i++)
+            start(i, *workers_[i]);
+    }
+}
+
+StreamDemux::StreamDemux(const Config &cfg, uint16_t port, FrameFn on_frame, TickFn on_tick)
+    : cfg_(cfg), on_frame_(std::move(on_frame)), on_tick_(std::move(on_tick))
+{
+    unsigned n = std::max(cfg_.workers, 1u);
+    for (unsigned i = 0; i < n; i++)
+    {
+        // The first socket settles an ephemeral port for the rest
+        auto w = std::make_unique<Worker>();
+        w->rx = std::make_unique<UdpRx>(i ? workers_[0]->rx->port() : port, 4 << 20,
+                                        std::max(cfg_.idle_ms, 1), true);
+        w->reply = w->rx.get();
+        workers_.push_back(std::move(w));
+    }
+    for (unsigned i = 0; i < n; i++)
+        start(i, *workers_[i]);
+}
+
+void StreamDemux::start(unsigned cpu, Worker &w)
+{
+    if (w.rx)
+        w.thread = std::thread(&StreamDemux::run_socket, this, std::ref(w));
+    else
+        w.thread = std::thread(&StreamDemux::run, this, std::ref(w));
+    if (cfg_.pin)
+    {
+        unsigned ncpu = std::max(std::thread::hardware_concurrency(), 1u);
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu % ncpu, &set);
+        pthread_setaffinity_np(w.thread.native_handle(), sizeof(set), &set); // best effort
+    }
+}
+
+uint16_t StreamDemux::port() const
+{
+    return workers_[0]->rx ? workers_[0]->rx->port() : workers_[0]->reply->port();
+}
+
+StreamDemux::~StreamDemux()
+{
+    stop();
+}
+
+void StreamDemux::stop()
+{
+    stop_ = true;
+    for (auto &w : workers_)
+    {
+        {
+            std::lock_guard<std::mutex> lock(w->wake_mu);
+            w->wake_cv.notify_one();
+        }
+        if (w->thread.joinable())
+            w->thread.join();
+        publish(*w);
+    }
+}
+
+uint64_t StreamDemux::route_key(std::unordered_map<uint64_t, uint64_t> &learned,
+                                const uint8_t *d, size_t len, const sockaddr_in &src)
+{
+    uint64_t addr = addr_key(src);
+    uint64_t id = id_key(d, len);
+    if (id)
+    {
+        if (learned.size() >= 4 * cfg_.max_streams && !learned.count(addr))
+            learned.clear(); // source churn; the live ones are relearnt at once
+        learned[addr] = id;
+        return id;
+    }
+    auto it = learned.find(addr);
+    return it != learned.end() ? it->second : addr;
+}
+
+void StreamDemux::push(const UdpRx &rx, int n, uint64_t now_ns)
+{
+    if (cfg_.record && n)
+        cfg_.record->add(rx, n, now_ns);
+    if (!cfg_.workers)
+    {
+        Worker &w = *workers_[0];
+        for (int i = 0; i < n; i++)
+            handle(w, route_key(learned_, rx.data(i), rx.size(i), rx.src(i)), rx.src(i),
+                   rx.data(i), rx.size(i), now_ns);
+        return;
+    }
+
+    uint64_t touched = 0; // bit per worker (the first 64)
+    for (int i = 0; i < n; i++)
+    {
+        uint64_t key = route_key(learned_, rx.data(i), rx.size(i), rx.src(i));
+        size_t wi = std::hash<uint64_t>()(key) % workers_.size();
+        Worker &w = *workers_[wi];
+        size_t head = w.head.load(std::memory_order_relaxed);
+        if (head - w.tail.load(std::memory_order_acquire) == w.ring.size())
+        {
+            w.drops.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        Item &it = w.ring[head % w.ring.size()];
+        it.key = key;
+        it.now_ns = now_ns;
+        it.src = rx.src(i);
+        it.len = uint16_t(rx.size(i));
+        std::memcpy(it.data, rx.data(i), it.len);
+        w.head.store(head + 1); // seq_cst: pairs with `sleeping` below
+        touched |= uint64_t(1) << (wi & 63);
+    }
+    for (size_t wi = 0; wi < workers_.size(); wi++)
+    {
+        Worker &w = *workers_[wi];
+        if ((touched >> (wi & 63) & 1) && w.sleeping.load())
+        {
+            std::lock_guard<std::mutex> lock(w.wake_mu);
+            w.wake_cv.notify_one();
+        }
+    }
+}
+
+void StreamDemux::poll(uint64_t now_ns)
+{
+    if (!cfg_.workers && !reuse_port())
+        service(*workers_[0], now_ns);
+}
+
+void StreamDemux::run(Worker &w)
+{
+    static constexpr size_t kBatch = UdpRx::kBatch;
+
+    while (!stop_)
+    {
+        size_t tail = w.tail.load(std::memory_order_relaxed);
+        size_t head = w.head.load(std::memory_order_acquire);
+        if (head == tail)
+        {
+            // Dekker with push(): either it sees `sleeping` and notifies, or
+            // the predicate sees its new head
+            std::unique_lock<std::mutex> lock(w.wake_mu);
+            w.sleeping.store(true);
+            w.wake_cv.wait_for(lock, std::chrono::milliseconds(cfg_.idle_ms),
+                               [&] { return stop_ || w.head.load() != tail; });
+            w.sleeping.store(false);
+            lock.unlock();
+            service(w, steady_ns());
+            continue;
+        }
+
+        size_t k = std::min(head - tail, kBatch);
+        for (size_t i = 0; i < k; i++)
+        {
+            const Item &it = w.ring[(tail + i) % w.ring.size()];
+            handle(w, it.key, it.src, it.data, it.len, it.now_ns);
+        }
+        w.tail.store(tail + k, std::memory_order_release);
+        service(w, steady_ns());
+    }
+}
+
+void StreamDemux::run_socket(Worker &w)
+{
+    UdpRx &rx = *w.rx;
+    while (!stop_)
+    {
+        int n;
+        try
+        {
+            n = rx.recv();
+        }
+        catch (const std::system_error &e)
+        {
+            // Hand it to the main thread (failed()) rather than let it end the
+            // process from here
+            std::lock_guard<std::mutex> lock(error_mu_);
+            if (!failed_)
+                error_ = e.what();
+            failed_ = true;
+            return;
+        }
+        uint64_t now_ns = steady_ns();
+        if (cfg_.record && n)
+            cfg_.record->add(rx, n, now_ns);
+        for (int i = 0; i < n; i++)
+            handle(w, route_key(w.learned, rx.data(i), rx.size(i), rx.src(i)), rx.src(i),
+                   rx.data(i), rx.size(i), now_ns);
+        service(w, now_ns);
+    }
+}
+
+bool StreamDemux::failed(std::string *what) const
+{
+    if (!failed_)
+        return false;
+    std::lock_guard<std::mutex> lock(error_mu_);
+    if (what)
+        *what = error_;
+    return true;
+}
+
+void StreamDemux::handle(Worker &w, uint64_t key, const sockaddr_in &src, const uint8_t *d,
+                         size_t len, uint64_t now_ns)
+{
+    auto it = w.streams.find(key);
+    if (it == w.streams.end())
+    {
+        uint32_t index = n_streams_.fetch_add(1);
+        if (index >= cfg_.max_streams)
+        {
+            n_streams_.fetch_sub(1);
+            over_limit_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        auto s = std::make_unique<Stream>(cfg_.assembler);
+        s->index = index;
+        s->key = key;
+        s->stream_id = (key & kIdKey) ? uint16_t(key) : 0;
+        if (s->stream_id)
+        {
+            s->name = "id " + std::to_string(s->stream_id);
+        }
+        else
+        {
+            char ip[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &src.sin_addr, ip, sizeof(ip));
+            s->name = std::string(ip) + ":" + std::to_string(ntohs(src.sin_port));
+        }
+        it = w.streams.emplace(key, std::move(s)).first;
+    }
+
+    Stream &s = *it->second;
+    s.src = src;
+    FrameView frame;
+    if (!s.assembler.push(d, len, now_ns, frame))
+        return;
+    w.latency.add(frame);
+    on_frame_(s, frame, now_ns);
+}
+
+void StreamDemux::service(Worker &w, uint64_t now_ns)
+{
+    FrameAssembler::Nack nacks[16];
+    uint8_t nack_buf[CHUNK_NACK_HDR_LEN + CHUNK_NACK_BITMAP_MAX];
+    bool expire = now_ns - w.last_expire_ns >= uint64_t(cfg_.idle_ms) * 1000000u;
+    if (expire)
+        w.last_expire_ns = now_ns;
+
+    for (auto &kv : w.streams)
+    {
+        Stream &s = *kv.second;
+        if (expire)
+            s.assembler.expire(now_ns);
+        if (cfg_.assembler.nack_after_ns)
+        {
+            size_t k = s.assembler.nacks(now_ns, nacks, sizeof(nacks) / sizeof(nacks[0]));
+            for (size_t i = 0; i < k; i++)
+            {
+                size_t len = chunk_nack_pack(nack_buf, nacks[i].frame_id, nacks[i].base,
+                                             nacks[i].bitmap, nacks[i].nbytes);
+                w.reply->send_to(s.src, nack_buf, len);
+            }
+        }
+        if (on_tick_)
+            on_tick_(s, now_ns);
+    }
+    if (expire)
+        publish(w);
+}
+
+// On w's thread: the only lock it takes, once per idle_ms
+void StreamDemux::publish(Worker &w)
+{
+    std::lock_guard<std::mutex> lock(w.snap_mu);
+    w.snap_sum = FrameAssembler::Stats();
+    w.snap_frames.clear();
+    for (const auto &kv : w.streams)
+    {
+        const FrameAssembler::Stats &st = kv.second->assembler.stats();
+        add_stats(w.snap_sum, st);
+        w.snap_frames.emplace_back(kv.second->index, st.frames);
+    }
+    w.snap_latency.absorb(w.latency);
+}
+
+StreamDemux::Totals StreamDemux::totals(std::vector<uint64_t> *frames) const
+{
+    Totals t;
+    t.over_limit = over_limit_.load(std::memory_order_relaxed);
+    for (const auto &w : workers_)
+    {
+        t.queue_drops += w->drops.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(w->snap_mu);
+        t.per_worker.push_back(w->snap_frames.size());
+        t.streams += w->snap_frames.size();
+        add_stats(t.sum, w->snap_sum);
+        if (frames)
+        {
+            for (const auto &f : w->snap_frames)
+            {
+                if (frames->size() <= f.first)
+                    frames->resize(f.first + 1);
+                (*frames)[f.first] = f.second;
+            }
+        }
+    }
+    return t;
+}
+
+void StreamDemux::take_latency(StageLatency &into)
+{
+    for (auto &w : workers_)
+    {
+        std::lock_guard<std::mutex> lock(w->snap_mu);
+        into.absorb(w->snap_latency);
+    }
+}
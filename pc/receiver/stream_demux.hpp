@@ -0,0 +1,192 @@
+// pc/receiver/stream_demux.hpp
+// Many cameras on one port: datagrams are split into streams, each with its
+// own FrameAssembler, and the streams are sharded over worker threads.
+//
+// Stream key: the stream_id of the timestamp extension (chunk_proto.h) when
+// the sender sets one, else the datagram's source address. Parity chunks and
+// aggregated datagrams of a stamped stream carry no id of their own; they
+// follow the id last seen from their source address.
+//
+// Sharding, two ways. A stream lives on exactly one worker either way, so its
+// assembler, NACK state and outputs are only ever touched by that thread.
+//   - Rings (StreamDemux(cfg, rx, ...)): push() on the caller's receive thread
+//     hashes the key to a worker and copies the datagram into that worker's
+//     single-producer ring; a full ring drops it. With workers = 0 everything
+//     runs on the caller's thread instead.
+//   - SO_REUSEPORT (StreamDemux(cfg, port, ...)): every worker receives on its
+//     own socket bound to the port and the kernel's 4-tuple hash keeps each
+//     sender on one of them. No receive thread, no copy, no hand-off; a sender
+//     that changes its source port may move to another worker, and then opens
+//     a new stream there.
+// Handling a datagram takes no lock: the worker publishes its streams' stats
+// and latency samples every idle_ms for totals() and take_latency().
+// pin puts worker i on CPU i (modulo the CPU count). With `record` set,
+// every datagram received is also appended to that capture file, before any
+// parsing, from whichever thread received it.
+//
+// Streams are numbered in order of first appearance (index 0, 1, ...);
+// datagrams that would open a stream past max_streams are dropped, so a flood
+// of spoofed sources cannot grow memory without bound.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <netinet/in.h>
+
+#include "frame_assembler.hpp"
+#include "stage_latency.hpp"
+#include "udp_rx.hpp"
+
+class CaptureWriter;
+
+class StreamDemux
+{
+public:
+    struct Config
+    {
+        FrameAssembler::Config assembler;
+        unsigned workers = 0;          // 0 = on the caller's thread
+        size_t max_streams = 64;
+        size_t queue_datagrams = 1024; // per worker
+        int idle_ms = 100;             // worker wake-up when idle (expiry, NACKs)
+        bool pin = false;              // worker i on CPU i
+        CaptureWriter *record = nullptr; // capture_file.hpp
+    };
+
+    struct Stream
+    {
+        uint32_t index;     // order of first appearance
+        uint64_t key;
+        uint16_t stream_id; // 0 = keyed by source address
+        sockaddr_in src;    // latest source address; NACKs go here
+        std::string name;   // "id N" or "IP:port"
+        FrameAssembler assembler;
+
+        explicit Stream(const FrameAssembler::Config &cfg) : assembler(cfg) {}
+    };
+
+    // Called on the stream's worker thread
+    using FrameFn = std::function<void(Stream &, const FrameView &, uint64_t now_ns)>;
+    using TickFn = std::function<void(Stream &, uint64_t now_ns)>;
+
+    // Rings. reply: socket the NACKs are sent from (thread-safe sendto)
+    StreamDemux(const Config &cfg, UdpRx &reply, FrameFn on_frame, TickFn on_tick = nullptr);
+    // SO_REUSEPORT: max(workers, 1) sockets on port (0 = ephemeral, shared by
+    // all). Throws std::system_error.
+    StreamDemux(const Config &cfg, uint16_t port, FrameFn on_frame, TickFn on_tick = nullptr);
+    ~StreamDemux();
+
+    StreamDemux(const StreamDemux &) = delete;
+    StreamDemux &operator=(const StreamDemux &) = delete;
+
+    // Rings: route the n datagrams of rx's last batch, received at now_ns
+    void push(const UdpRx &rx, int n, uint64_t now_ns);
+
+    // Rings, workers = 0: expiry, NACKs and on_tick for every stream; call
+    // after each push() or timeout. No-op otherwise.
+    void poll(uint64_t now_ns);
+
+    // The port datagrams arrive on
+    uint16_t port() const;
+    // Receives on its own sockets (no push()/poll() needed)
+    bool reuse_port() const { return !workers_.empty() && workers_[0]->rx != nullptr; }
+
+    struct Totals
+    {
+        FrameAssembler::Stats sum; // over all streams
+        size_t streams = 0;
+        uint64_t queue_drops = 0;  // worker ring full
+        uint64_t over_limit = 0;   // datagrams past max_streams
+        std::vector<size_t> per_worker; // streams on each worker
+    };
+
+    // Safe from any thread; as of each worker's last publish, up to idle_ms
+    // ago. frames, if given, gets completed frames per stream index.
+    Totals totals(std::vector<uint64_t> *frames = nullptr) const;
+
+    // Move the published latency samples of all streams into `into`
+    void take_latency(StageLatency &into);
+
+    // Stop and join the workers and publish what they hold, so totals() from
+    // here on covers every datagram handled. The destructor calls it.
+    void stop();
+
+    // SO_REUSEPORT: a worker's socket failed and that worker stopped. Returns
+    // false while all is well, else true with the error in *what. The caller
+    // should give up, as it would on its own socket failing.
+    bool failed(std::string *what) const;
+
+    // Stream key of a datagram: (1 << 48 | stream_id) if it carries one, else 0
+    static uint64_t id_key(const uint8_t *dgram, size_t len);
+    static uint64_t addr_key(const sockaddr_in &src);
+
+private:
+    struct Item
+    {
+        uint64_t key;
+        uint64_t now_ns;
+        sockaddr_in src;
+        uint16_t len;
+        uint8_t data[UdpRx::kMaxDatagram];
+    };
+
+    struct Worker
+    {
+        std::vector<Item> ring;
+        alignas(64) std::atomic<size_t> head{0}; // written by push()
+        alignas(64) std::atomic<size_t> tail{0}; // written by the worker
+        std::atomic<bool> sleeping{false};
+        std::mutex wake_mu;
+        std::condition_variable wake_cv;
+        std::atomic<uint64_t> drops{0}; // ring full, counted by push()
+
+        // The worker's own (the caller's with workers = 0)
+        std::unordered_map<uint64_t, std::unique_ptr<Stream>> streams;
+        StageLatency latency;
+        uint64_t last_expire_ns = 0;
+        std::unique_ptr<UdpRx> rx;   // SO_REUSEPORT: this worker's socket
+        UdpRx *reply = nullptr;      // NACKs go out here
+        std::unordered_map<uint64_t, uint64_t> learned; // SO_REUSEPORT: see learned_
+        std::thread thread;
+
+        // publish(): worker vs totals(), take_latency()
+        mutable std::mutex snap_mu;
+        FrameAssembler::Stats snap_sum;
+        std::vector<std::pair<uint32_t, uint64_t>> snap_frames; // index, frames
+        StageLatency snap_latency;
+    };
+
+    void start(unsigned cpu, Worker &w);
+    void run(Worker &w);
+    void run_socket(Worker &w);
+    void handle(Worker &w, uint64_t key, const sockaddr_in &src, const uint8_t *d, size_t len,
+                uint64_t now_ns);
+    void service(Worker &w, uint64_t now_ns);
+    void publish(Worker &w);
+    uint64_t route_key(std::unordered_map<uint64_t, uint64_t> &learned, const uint8_t *d,
+                       size_t len, const sockaddr_in &src);
+
+    Config cfg_;
+    FrameFn on_frame_;
+    TickFn on_tick_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::unordered_map<uint64_t, uint64_t> learned_; // addr key -> id key, push() only
+    std::atomic<uint32_t> n_streams_{0};
+    std::atomic<uint64_t> over_limit_{0};
+    std::atomic<bool> stop_{false};
+    std::atomic<bool> failed_{false};
+    mutable std::mutex error_mu_;
+    std::string error_; // first worker failure
+};
@@ -0,0 +1,90 @@
+// pc/receiver/udp_rx.cpp
+
+#include "udp_rx.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <arpa/inet.h>
+#include <unistd.h>
+
+static std::system_error sys_error(const char *what)
+{
+    return std::system_error(errno, std::generic_category(), what);
+}
+
+UdpRx::UdpRx(uint16_t port, int rcvbuf_bytes, int timeout_ms, bool reuse_port)
+    : bufs_(size_t(kBatch) * kMaxDatagram)
+{
+    fd_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (fd_ < 0)
+        throw sys_error("socket");
+
+    // Best effort: the kernel caps this at net.core.rmem_max
+    setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &rcvbuf_bytes, sizeof(rcvbuf_bytes));
+
+    timeval tv = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+    setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    int one = 1;
+    if (reuse_port && setsockopt(fd_, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0)
+    {
+        auto err = sys_error("SO_REUSEPORT");
+        close(fd_);
+        throw err;
+    }
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+    {
+        auto err = sys_error("bind");
+        close(fd_);
+        throw err;
+    }
+
+    socklen_t alen = sizeof(addr);
+    getsockname(fd_, reinterpret_cast<sockaddr *>(&addr), &alen);
+    port_ = ntohs(addr.sin_port);
+
+    for (int i = 0; i < kBatch; i++)
+    {
+        iov_[i].iov_base = &bufs_[size_t(i) * kMaxDatagram];
+        iov_[i].iov_len = kMaxDatagram;
+        std::memset(&msgs_[i], 0, sizeof(msgs_[i]));
+        msgs_[i].msg_hdr.msg_iov = &iov_[i];
+        msgs_[i].msg_hdr.msg_iovlen = 1;
+        msgs_[i].msg_hdr.msg_name = &addrs_[i];
+        msgs_[i].msg_hdr.msg_namelen = sizeof(addrs_[i]);
+    }
+}
+
+UdpRx::~UdpRx()
+{
+    if (fd_ >= 0)
+        close(fd_);
+}
+
+int UdpRx::recv()
+{
+    for (int i = 0; i < kBatch; i++)
+        msgs_[i].msg_hdr.msg_namelen = sizeof(addrs_[i]);
+
+    int n = recvmmsg(fd_, msgs_, kBatch, MSG_WAITFORONE, nullptr);
+    if (n < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            return 0;
+        throw sys_error("recvmmsg");
+    }
+    return n;
+}
+
+bool UdpRx::send_to(const sockaddr_in &dst, const void *buf, size_t len)
+{
+    return sendto(fd_, buf, len, MSG_DONTWAIT, reinterpret_cast<const sockaddr *>(&dst),
+                  sizeof(dst)) == ssize_t(len);
+}
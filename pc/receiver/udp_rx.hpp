@@ -0,0 +1,51 @@
+// pc/receiver/udp_rx.hpp
+// Batched UDP receive with recvmmsg(): one syscall returns up to kBatch
+// datagrams into buffers allocated once at construction.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+class UdpRx
+{
+public:
+    static constexpr int kBatch = 64;
+    static constexpr size_t kMaxDatagram = 4096;
+
+    // Bind 0.0.0.0:port (0 = ephemeral). reuse_port sets SO_REUSEPORT, so
+    // several sockets share the port and the kernel spreads senders over them
+    // by 4-tuple hash. Throws std::system_error.
+    explicit UdpRx(uint16_t port, int rcvbuf_bytes = 4 << 20, int timeout_ms = 100,
+                   bool reuse_port = false);
+    ~UdpRx();
+
+    UdpRx(const UdpRx &) = delete;
+    UdpRx &operator=(const UdpRx &) = delete;
+
+    // Wait for at least one datagram, then take whatever else is queued.
+    // Returns the batch size; 0 on timeout. Throws on socket errors.
+    int recv();
+
+    const uint8_t *data(int i) const { return &bufs_[size_t(i) * kMaxDatagram]; }
+    size_t size(int i) const { return msgs_[i].msg_len; }
+    const sockaddr_in &src(int i) const { return addrs_[i]; }
+
+    // Send a reply (NACK) from the bound port; best effort, false if it failed
+    bool send_to(const sockaddr_in &dst, const void *buf, size_t len);
+
+    int fd() const { return fd_; }
+    uint16_t port() const { return port_; }
+
+private:
+    int fd_ = -1;
+    uint16_t port_ = 0;
+    std::vector<uint8_t> bufs_;
+    mmsghdr msgs_[kBatch];
+    iovec iov_[kBatch];
+    sockaddr_in addrs_[kBatch];
+};
@@ -0,0 +1,86 @@
+# pc/ring_reader.py
+# Reference reader for lvrecv's shared-memory frame ring (common/frame_ring.h).
+# Frames are read straight out of the mapping; the only syscall is a short
+# sleep while no new frame has arrived.
+#
+#   python3 ring_reader.py [--ring /dev/shm/lvrecv.ring] [--show]
+#   python3 ring_reader.py --pipe | ffmpeg -f mjpeg -i - ...
+#
+# --show needs OpenCV (cv2) and numpy.
+
+import argparse, mmap, struct, sys, time
+
+MAGIC = b"LVRING1"
+HDR_BYTES = 64
+SLOT_HDR_BYTES = 32
+HDR_FMT = "<8sIIII Q"  # magic, version, slots, slot_bytes, reserved0, write_count
+SLOT_FMT = "<Q I I Q"  # seq, frame_id, size, stamp_ns
+WRITE_COUNT_OFF = 24
+
+
+def open_ring(path):
+    with open(path, "rb") as f:
+        mm = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+    magic, version, slots, slot_bytes, _, _ = struct.unpack_from(HDR_FMT, mm, 0)
+    if magic.rstrip(b"\0") != MAGIC or version != 1:
+        raise SystemExit("%s: not a frame ring" % path)
+    return mm, slots, slot_bytes
+
+
+def read_frame(mm, slots, slot_bytes, k):
+    """Copy frame k out of its slot; None if it was overwritten meanwhile."""
+    base = HDR_BYTES + (k % slots) * slot_bytes
+    want = 2 * k + 2
+    s1, frame_id, size, stamp_ns = struct.unpack_from(SLOT_FMT, mm, base)
+    if s1 != want:
+        return None
+    jpeg = mm[base + SLOT_HDR_BYTES : base + SLOT_HDR_BYTES + size]
+    (s2,) = struct.unpack_from("<Q", mm, base)
+    if s2 != want:
+        return None
+    return frame_id, stamp_ns, jpeg
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--ring", default="/dev/shm/lvrecv.ring")
+    ap.add_argument("--show", action="store_true", help="display with OpenCV")
+    ap.add_argument("--pipe", action="store_true", help="write MJPEG to stdout")
+    args = ap.parse_args()
+
+    mm, slots, slot_bytes = open_ring(args.ring)
+    print("[ring] %s slots=%d slot_bytes=%d" % (args.ring, slots, slot_bytes), file=sys.stderr)
+
+    if args.show:
+        import cv2
+        import numpy as np
+
+    last = -1
+    while True:
+        (count,) = struct.unpack_from("<Q", mm, WRITE_COUNT_OFF)
+        k = count - 1
+        if k == last or k < 0:
+            time.sleep(0.001)
+            continue
+
+        got = read_frame(mm, slots, slot_bytes, k)
+        last = k
+        if got is None:
+            continue
+        frame_id, stamp_ns, jpeg = got
+
+        if args.pipe:
+            sys.stdout.buffer.write(jpeg)
+            sys.stdout.buffer.flush()
+        elif args.show:
+            img = cv2.imdecode(np.frombuffer(jpeg, np.uint8), cv2.IMREAD_COLOR)
+            if img is not None:
+                cv2.imshow("lvrecv", img)
+            if cv2.waitKey(1) == 27:
+                break
+        else:
+            print("[ring] frame_id=%d bytes=%d" % (frame_id, len(jpeg)), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,186 @@
+# pc/telemetry.py
+# Listener for the ESP32 forwarder's telemetry datagram (common/telemetry.h),
+# sent once a second to the chunk port + 1. Prints per-second rates and the
+# share of CPU time spent waiting on SPI, forwarding and in sendto().
+#
+#   python3 telemetry.py [--port 5007] [--csv out.csv] [--plot]
+#
+# --plot needs matplotlib. Counters are cumulative u32s; rates are taken over
+# the uptime difference between datagrams, modulo 2^32.
+
+import argparse, socket, struct, sys, time
+
+MAGIC = b"LVTM"
+HDR_FMT = "<4sBBH"  # magic, version, count, rsv
+HDR_BYTES = 8
+
+# telem_field_t order; new fields are appended, unknown ones ignored
+FIELDS = [
+    "seq", "uptime_ms", "cpu_mhz",
+    "rx_chunks", "rx_bytes", "rx_dropped", "spi_wait_cycles",
+    "tx_chunks", "tx_dgrams", "tx_bytes", "tx_errors", "tx_enomem",
+    "send_cycles", "fwd_cycles", "backlog_sum",
+    "fec_chunks", "retx_chunks", "nacks", "agg_dgrams", "free_heap",
+    "tx_retries", "tx_lost", "tx_shed", "frames_shed", "tx_stale", "frames_stale",
+    "rx_crc_bad", "crc_cycles", "rx_resyncs", "rx_skipped",
+]
+GAUGES = {"seq", "uptime_ms", "cpu_mhz", "free_heap"}
+
+# Derived per-second columns, in print / CSV order
+COLUMNS = [
+    "rx_chunks/s", "rx_kB/s", "tx_dgrams/s", "tx_kB/s", "dropped/s", "errors/s",
+    "enomem/s", "spi_wait%", "fwd%", "sendto%", "backlog", "fec/s", "retx/s",
+    "nacks/s", "agg/s", "heap_kB", "retries/s", "lost/s", "shed/s", "frames_shed/s",
+    "stale/s", "frames_stale/s", "crc_bad/s", "crc%", "resync/s", "skipped_B/s",
+]
+
+
+def parse(data):
+    """dict of field -> value, or None if this is not a telemetry datagram."""
+    if len(data) < HDR_BYTES:
+        return None
+    magic, version, count, _ = struct.unpack_from(HDR_FMT, data, 0)
+    if magic != MAGIC or version != 1 or len(data) < HDR_BYTES + 4 * count:
+        return None
+    vals = struct.unpack_from("<%dI" % count, data, HDR_BYTES)
+    return dict(zip(FIELDS, vals))
+
+
+def rates(prev, cur):
+    """Per-second figures between two samples; None across a reboot."""
+    if cur["seq"] <= prev["seq"]:  # restarted (or reordered)
+        return None
+    dt_ms = (cur["uptime_ms"] - prev["uptime_ms"]) & 0xFFFFFFFF
+    if dt_ms == 0:
+        return None
+    dt = dt_ms / 1e3
+    d = {k: (cur[k] - prev[k]) & 0xFFFFFFFF for k in cur if k in prev and k not in GAUGES}
+    cyc = cur["cpu_mhz"] * 1e6 * dt or 1.0
+    rx = d.get("rx_chunks", 0)
+    return {
+        "rx_chunks/s": rx / dt,
+        "rx_kB/s": d.get("rx_bytes", 0) / dt / 1e3,
+        "tx_dgrams/s": d.get("tx_dgrams", 0) / dt,
+        "tx_kB/s": d.get("tx_bytes", 0) / dt / 1e3,
+        "dropped/s": d.get("rx_dropped", 0) / dt,
+        "errors/s": d.get("tx_errors", 0) / dt,
+        "enomem/s": d.get("tx_enomem", 0) / dt,
+        "spi_wait%": 100.0 * d.get("spi_wait_cycles", 0) / cyc,
+        "fwd%": 100.0 * d.get("fwd_cycles", 0) / cyc,
+        "sendto%": 100.0 * d.get("send_cycles", 0) / cyc,
+        "backlog": d.get("backlog_sum", 0) / rx if rx else 0.0,
+        "fec/s": d.get("fec_chunks", 0) / dt,
+        "retx/s": d.get("retx_chunks", 0) / dt,
+        "nacks/s": d.get("nacks", 0) / dt,
+        "agg/s": d.get("agg_dgrams", 0) / dt,
+        "heap_kB": cur.get("free_heap", 0) / 1e3,
+        "retries/s": d.get("tx_retries", 0) / dt,
+        "lost/s": d.get("tx_lost", 0) / dt,
+        "shed/s": d.get("tx_shed", 0) / dt,
+        "frames_shed/s": d.get("frames_shed", 0) / dt,
+        "stale/s": d.get("tx_stale", 0) / dt,
+        "frames_stale/s": d.get("frames_stale", 0) / dt,
+        "crc_bad/s": d.get("rx_crc_bad", 0) / dt,
+        "crc%": 100.0 * d.get("crc_cycles", 0) / cyc,
+        "resync/s": d.get("rx_resyncs", 0) / dt,
+        "skipped_B/s": d.get("rx_skipped", 0) / dt,
+    }
+
+
+class Plot:
+    PANELS = [
+        ("throughput (kB/s)", ["rx_kB/s", "tx_kB/s"]),
+        ("CPU share (%)", ["spi_wait%", "fwd%", "sendto%", "crc%"]),
+        ("events (/s)", ["dropped/s", "crc_bad/s", "resync/s", "enomem/s", "retries/s", "lost/s",
+                         "shed/s", "stale/s"]),
+        ("tx queue depth", ["backlog"]),
+    ]
+
+    def __init__(self, window):
+        import matplotlib.pyplot as plt
+
+        self.plt = plt
+        self.window = window
+        self.t = []
+        self.series = {c: [] for _, cols in self.PANELS for c in cols}
+        self.fig, self.axes = plt.subplots(len(self.PANELS), 1, sharex=True)
+        self.lines = {}
+        for ax, (title, cols) in zip(self.axes, self.PANELS):
+            ax.set_ylabel(title, fontsize="small")
+            for c in cols:
+                (self.lines[c],) = ax.plot([], [], label=c)
+            ax.legend(loc="upper left", fontsize="x-small")
+        self.axes[-1].set_xlabel("uptime (s)")
+        plt.ion()
+        plt.show()
+
+    def add(self, t, r):
+        self.t.append(t)
+        for c, v in self.series.items():
+            v.append(r[c])
+        if len(self.t) > self.window:
+            del self.t[0]
+            for v in self.series.values():
+                del v[0]
+        for c, line in self.lines.items():
+            line.set_data(self.t, self.series[c])
+        for ax in self.axes:
+            ax.relim()
+            ax.autoscale_view()
+
+    def pump(self):
+        self.plt.pause(0.05)
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--bind", default="0.0.0.0")
+    ap.add_argument("--port", type=int, default=5007, help="chunk port + 1")
+    ap.add_argument("--csv", help="append one row per second to this file")
+    ap.add_argument("--plot", action="store_true", help="live plot (matplotlib)")
+    ap.add_argument("--window", type=int, default=300, help="seconds shown by --plot")
+    args = ap.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind((args.bind, args.port))
+    sock.settimeout(0.05 if args.plot else None)
+    plot = Plot(args.window) if args.plot else None
+    csv = open(args.csv, "a", buffering=1) if args.csv else None
+    if csv and csv.tell() == 0:
+        csv.write(",".join(["wall", "uptime_s"] + COLUMNS) + "\n")
+    print("[telemetry] listening %s:%d" % (args.bind, args.port), file=sys.stderr)
+
+    prev = {}  # per source address
+    while True:
+        try:
+            data, src = sock.recvfrom(2048)
+        except socket.timeout:
+            plot.pump()
+            continue
+        cur = parse(data)
+        if cur is None:
+            continue
+        last, prev[src] = prev.get(src), cur
+        r = rates(last, cur) if last else None
+        if r is None:
+            continue
+
+        up = cur["uptime_ms"] / 1e3
+        print("[%s %7.0fs] rx %5.0f ch/s %6.1f kB/s  tx %5.0f dg/s  spi %4.1f%% fwd %4.1f%% "
+              "sendto %4.1f%%  q %.2f  drop %.0f enomem %.0f lost %.0f shed %.0f stale %.0f retx %.0f  heap %.0f kB"
+              % (src[0], up, r["rx_chunks/s"], r["rx_kB/s"], r["tx_dgrams/s"], r["spi_wait%"],
+                 r["fwd%"], r["sendto%"], r["backlog"], r["dropped/s"], r["enomem/s"],
+                 r["lost/s"], r["shed/s"], r["stale/s"], r["retx/s"], r["heap_kB"]))
+        if csv:
+            csv.write(",".join(["%.3f" % time.time(), "%.3f" % up] +
+                               ["%.3f" % r[c] for c in COLUMNS]) + "\n")
+        if plot:
+            plot.add(up, r)
+            plot.pump()
+
+
+if __name__ == "__main__":
+    try:
+        main()
+    except KeyboardInterrupt:
+        pass